@@ -11,6 +11,8 @@
  * Base for real or virtual boards.
  * It keeps track of which position if occupied by each player
  * by filling a vector with the player IDs.
+ * It only answers questions about the stones, so that any board can be examined
+ * through it. Stones are set through BoardCore.
  */
 class AbstractBoard {
 public:
@@ -18,15 +20,15 @@ public:
     explicit AbstractBoard(int size) :
             size_(size), stones_(size * size) {
     }
-    virtual ~AbstractBoard() {
-    }
 
-    /* Returns true if the player has connected the two edges of the board. */
-    bool HasWon(const Player&) const;
     //Returns true if any user has occupied the position.
     bool IsOccupied(int pos) const {
         return stones_[pos] != 0;
     }
+    //Returns true if the user has set a stone in the given position.
+    bool Belongs(int pos, const Player& player) const {
+        return stones_[pos] == player.GetId();
+    }
     //Returns the number of positions per board side.
     int GetSize() const {
         return size_;
@@ -35,31 +37,14 @@ public:
     std::unordered_set<int> GetOccupiedPositions() const;
     //Returns a list of the free positions in the board.
     std::unordered_set<int> GetFreePositions() const;
-    //Marks a position as occupied by a player and updates the board accordingly.
-    void Occupy(int pos, const Player& player) {
-        OccupyImpl(pos, player);
-    }
 protected:
-    //Used when a player occupies a position.
-    void SetStone(int pos, const Player& player) {
+    //Boards are never destroyed through this class.
+    ~AbstractBoard() {
+    }
+    void PlaceStone(int pos, const Player& player) {
         stones_[pos] = player.GetId();
-        AddMissingConnections(pos, player);
     }
 private:
-    //Set stones, mark the board and/or mark connections as needed.
-    virtual void OccupyImpl(int pos, const Player&) = 0;
-    //Mark two positions as connected by a player.
-    virtual void MarkConnected(int pos1, int pos2, const Player& player) = 0;
-    //Returns true if pos1 and pos2 have stones of the same player.
-    virtual bool AreConnected(int pos1, int pos2, const Player& player) const = 0;
-    //After a stone was set, mark surrounding positions as connected
-    //by the player if they also have player's stones.
-    void AddMissingConnections(int pos, const Player&);
-    //Returns true if the user has set a stone in the given position.
-    bool Belongs(int pos, const Player& player) const {
-        return stones_[pos] == player.GetId();
-    }
-
     const int size_;
     //Stores occupied positions with the players IDs.
     std::vector<int> stones_;
@@ -97,4 +82,65 @@ void ApplyAroundPosition(int pos, const Player* p, int size_, Applier apl, Appro
     }
 }
 
+/*
+ * Stone placing and win detection shared by the real and virtual boards.
+ * The derived board is the template argument, and the calls to its
+ * connection methods are resolved at compile time (CRTP), so they can be
+ * inlined in the loops of AddMissingConnections and HasWon.
+ * Derived has to implement:
+ *   void OccupyImpl(int pos, const Player&)
+ *     Set stones, mark the board and/or mark connections as needed.
+ *   void MarkConnected(int pos1, int pos2, const Player&)
+ *     Mark two positions as connected by a player.
+ *   bool AreConnected(int pos1, int pos2, const Player&) const
+ *     Returns true if a chain of the player's stones connects pos1 and pos2.
+ * The two virtual nodes after the positions represent the board edges.
+ */
+template<typename Derived>
+class BoardCore: public AbstractBoard {
+public:
+    explicit BoardCore(int size) :
+            AbstractBoard(size) {
+    }
+
+    /* Returns true if the player has connected the two edges of the board. */
+    bool HasWon(const Player&) const;
+    //Marks a position as occupied by a player and updates the board accordingly.
+    void Occupy(int pos, const Player& player) {
+        GetDerived().OccupyImpl(pos, player);
+    }
+protected:
+    //Used when a player occupies a position.
+    void SetStone(int pos, const Player& player) {
+        PlaceStone(pos, player);
+        AddMissingConnections(pos, player);
+    }
+private:
+    Derived& GetDerived() {
+        return static_cast<Derived&>(*this);
+    }
+    const Derived& GetDerived() const {
+        return static_cast<const Derived&>(*this);
+    }
+    //After a stone was set, mark surrounding positions as connected
+    //by the player if they also have player's stones.
+    void AddMissingConnections(int pos, const Player& player) {
+        ApplyAroundPosition(pos, &player, GetSize(), [this](int x, int y, const Player* p) {
+            GetDerived().MarkConnected(x, y, *p);
+        }, [this](int x, const Player* p) -> bool {
+            return Belongs(x, *p);
+        });
+    }
+};
+
+//The player has won when the two virtual nodes that represent
+//the board edges are connected.
+template<typename Derived>
+bool BoardCore<Derived>::HasWon(const Player& player) const {
+    int num_vertices = GetSize() * GetSize() + 2;
+    int first_virtual = num_vertices - 1;
+    int second_virtual = num_vertices - 2;
+    return GetDerived().AreConnected(first_virtual, second_virtual, player);
+}
+
 #endif /* defined(__Hex_AI__AbstractBoard__) */
@@ -6,72 +6,184 @@
 #include <vector>
 #include <utility>
 #include <ctime>
+#include <chrono>
 #include <cassert>
 #include <cstddef>
 #include <future>
 #include <atomic>
 #include <cstdbool>
 #include <functional>
+#include <numeric>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <signal.h>
+#include <stdexcept>
 #include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
 
-#include "Graph.h"
+#include "InferiorCells.h"
 #include "Move.h"
+#include "NeuralBatcher.h"
 #include "Player.h"
+#include "SearchHandle.h"
+#include "SharedMemory.h"
+#include "SharedTree.h"
+#include "Simulation.h"
+#include "Trace.h"
 #include "ThreadPool.h"
 #include "VirtualBoard.h"
+#include "VirtualConnections.h"
+#include "Zobrist.h"
 
 using namespace std;
 
 namespace {
 
-    atomic<bool> abort_sim(false);
-
     const double GIVE_UP_FACTOR = 0.25; //higher values make the AI give up more easily
 
+    //Maximum simulations for each opponent response.
     const int SIMULATIONS = 1100;
+    //Simulations for each response that is still racing in every round.
+    const int ROUND_SIMULATIONS = 100;
+    //Simulations of the shared tree search for every candidate.
+    const long long TREE_SIMULATIONS = 10 * SIMULATIONS;
+
+    //A move whose worst response leaves this win ratio can't be overtaken in any way
+    //that matters, the search stops there.
+    const double SETTLED_WIN_PROB = 0.95;
+    //Candidates refuted before the confidence intervals can stop the PRUNING search. The
+    //candidates left are less promising than them, but a few are needed to trust that.
+    const int MIN_SETTLED_REFUTATIONS = 3;
+
+    //Seconds between the checks of the coordinator while the worker processes search.
+    const double PROCESS_POLL_SECONDS = 0.005;
+
+    //Seconds that the worker processes get to finish after they are told to stop, before
+    //they are killed.
+    const double PROCESS_GRACE_SECONDS = 1;
+
+    //Memory shared with the worker processes: the stop flag in the first 64 bytes, and then
+    //a block for each process with a flag set when it is done, its progress, and for every
+    //candidate the wins and simulations that the process ran, and the ones known before the
+    //search. The flag and the progress are atomic, the rest is read once the flag is set.
+    const size_t PROCESSES_HEADER_SIZE = 64;
+    const size_t PROCESS_FIELDS = 4;
+    const size_t PROCESS_DONE = 0;
+    const size_t PROCESS_PLAYOUTS = 1;
+    const size_t PROCESS_BEST_POS = 2; //-1 before the first report
+    const size_t PROCESS_WIN_RATE = 3; //in millionths
+    const double PROCESS_WIN_RATE_SCALE = 1e6;
+
+    size_t GetProcessBlockSize(size_t candidates) {
+        return PROCESS_FIELDS * sizeof(int32_t) * (1 + candidates);
+    }
+
+    //Seconds between the progress reports of the shared tree search.
+    const double PROGRESS_INTERVAL = 0.1;
+
+    //Under a game clock, every move gets the time left divided by a share of the free
+    //positions, and at least a minimum time.
+    const double CLOCK_MOVES_PER_FREE_POSITION = 0.25;
+    const double MIN_MOVE_SECONDS = 0.05;
+
+    //Most promising moves of the AI and responses of the opponent that are simulated on the
+    //boards bigger than the limit, so that the search time doesn't grow with the board size.
+    //The smaller boards simulate all of them.
+    const int MAX_UNLIMITED_BOARD_SIZE = 14;
+    const size_t MAX_CANDIDATES = 40;
+    const size_t MAX_RESPONSES = 40;
+
+    //How the simulations draw the random fillings of the board.
+    const SamplingMode SAMPLING = SamplingMode::ANTITHETIC;
+
+    //Simulations that the value of the network is worth.
+    const int NETWORK_SIMULATIONS = 2 * SharedTree::LEAF_SIMULATIONS;
+
+    //Returns the indexes of the responses: first the ones with results of the previous turn,
+    //from the worst to the best for the computer since they are the likeliest refutations,
+    //and then the others in their order.
+    vector<int> OrderByPreviousTurn(const vector<SimulationTally>& previous) {
+        vector<int> order(previous.size());
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [&previous](int first, int second) {
+            bool first_known = previous[first].GetSimulations() > 0;
+            bool second_known = previous[second].GetSimulations() > 0;
+            if (first_known != second_known) return first_known;
+            return first_known && previous[first].GetWinRatio() < previous[second].GetWinRatio();
+        });
+        return order;
+    }
+
+    //Returns the moves that are simulated for a board size.
+    size_t GetMaxMoves(size_t max_moves, int board_size) {
+        return board_size > MAX_UNLIMITED_BOARD_SIZE ? max_moves : numeric_limits<size_t>::max();
+    }
+
+    //Returns true if the opponent response makes the AI's chances worse than win_prob.
+    bool IsRefutation(const SimulationTally& tally, double win_prob) {
+        if (tally.GetSimulations() >= SIMULATIONS) {
+            return tally.GetWinRatio() < win_prob;
+        }
+        return tally.GetUpperBound() < win_prob;
+    }
+
+    //Removes the positions whose rotated position is also in the set, keeping the lowest one.
+    //They lead to the same game when the board is the same after the rotation.
+    void RemoveRotatedMoves(unordered_set<int>& positions, int board_size) {
+        int last_pos = board_size * board_size - 1;
+        for (auto it = positions.begin(); it != positions.end();) {
+            int rotated = last_pos - *it;
+            it = rotated < *it && positions.count(rotated) > 0 ? positions.erase(it) : next(it);
+        }
+    }
+
+    //Board positions that bound the shifts of the position sets.
+    struct BoardMasks {
+        CellSet all;
+        CellSet first_col;
+        CellSet last_col;
+    };
 
-    /*
-     * Runs a Monte Carlo simulation of 1000 possible results of the opponent occupying a position.
-     * This function will run in multiple threads for each possible position.
-     * Simulations can be aborted with the flag abort_sim.
-     * pos              The position occupied by the opponent
-     * free_pos_set     The free positions in the board before the opponent's movement
-     * board            The board initialized with the computer's occupied positions
-     * nodes_to_fill    The pre-calculated amount of positions that the computer can occupy
-     *                  (half of the board+)
-     * Returns the computer's calculated win ratio if its opponent occupies the given position.
-     */
-    double GetMonteCarloWinRatio(int pos,
-                                 unordered_set<int> free_pos_set,
-                                 const VirtualBoard& board,
-                                 int pos_to_fill) {
-        if (abort_sim) return 0;
-        default_random_engine engine { random_device { }() };
-        int wins = 0;
-        free_pos_set.erase(pos);
-        vector<int> free_nodes(free_pos_set.begin(), free_pos_set.end());
-        for (int sims = 0; sims < SIMULATIONS && !abort_sim; sims++) {
-            shuffle(free_nodes.begin(), free_nodes.end(), engine); //shuffle free positions
-            //board is preinitialized with already occupied positions in the real board
-            //plus one position occupied by AI in the top level of the simulation
-            VirtualBoard new_board = board;
-            //fill half the board with AI stones and check if it connected the edges
-            new_board.FillBoard(free_nodes, pos_to_fill);
-            if (new_board.HasWon()) {
-                wins++; //we have a winner
-            }
-        }
-        return static_cast<double>(wins) / SIMULATIONS;
-    }
-
-    //Sets all the edges surrounding a vertex in a graph as connected.
-    template<typename T>
-    void AddSurroundingEdges(const int node, const int board_size, Graph<T>& graph) {
-        ApplyAroundPosition(node, nullptr, board_size, [&graph](int x, int y, const Player* p){
-            graph.AddEdge(x, y);
-        }, [](int x, const Player* p){ return true; });
+    BoardMasks MakeMasks(int board_size) {
+        BoardMasks masks;
+        for (int row = 0; row < board_size; row++) {
+            masks.first_col.set(row * board_size);
+            masks.last_col.set(row * board_size + board_size - 1);
+        }
+        for (int pos = 0; pos < board_size * board_size; pos++) {
+            masks.all.set(pos);
+        }
+        return masks;
+    }
+
+    //Returns the neighbors of all the positions at once, shifting the set
+    //in the 6 directions of ApplyAroundPosition.
+    CellSet GetNeighbors(const CellSet& cells, const BoardMasks& masks, int board_size) {
+        CellSet not_first = cells & ~masks.first_col;
+        CellSet not_last = cells & ~masks.last_col;
+        CellSet around = (not_first >> 1) | (not_last << 1)
+                | (cells >> board_size) | (not_last >> (board_size - 1))
+                | (not_first << (board_size - 1)) | (cells << board_size);
+        return around & masks.all;
+    }
+
+    //Returns the positions reachable from the start by moving between neighbors
+    //when at least one of them is a hub. The start is always reached.
+    CellSet GetReachableFrom(int start, const CellSet& hubs, const BoardMasks& masks, int board_size) {
+        CellSet reached;
+        reached.set(start);
+        CellSet frontier = reached;
+        while (frontier.any()) {
+            frontier = (GetNeighbors(frontier & hubs, masks, board_size)
+                    | (GetNeighbors(frontier, masks, board_size) & hubs)) & ~reached;
+            reached |= frontier;
+        }
+        return reached;
     }
 
     //Compares two entries in a map and returns true if the value of the second is higher.
@@ -81,107 +193,881 @@ namespace {
 }
 
 Move Ai::ComputeMove() {
-    cout << "... ";
-    fflush(stdout);
-    int pos = ChoosePosition();
+    int pos = ComputePosition();
     if (pos < 0) {
         return Move(Move::AI_GIVE_UP_CODE, board_);
     }
+    return Move(Move::GetName(pos, board_.GetSize()), board_);
+}
+
+int Ai::ComputePosition() {
+    if (searching_.exchange(true)) {
+        throw logic_error("the AI is already searching");
+    }
+    struct Finish {
+        Ai& ai;
+        ~Finish() {
+            ai.searching_ = false;
+        }
+    } finish { *this };
+    stop_requested_ = false;
+    StartClock();
+    return Search();
+}
+
+unique_ptr<SearchHandle> Ai::StartSearch(ProgressCallback callback) {
+    if (searching_.exchange(true)) {
+        throw logic_error("the AI is already searching");
+    }
+    stop_requested_ = false;
+    progress_callback_ = move(callback);
+    //the time limit exists before the handle does, so that it can be extended at once
+    StartClock();
+    future<int> result;
+    try {
+        result = async(launch::async, [this] {
+            struct Finish {
+                Ai& ai;
+                ~Finish() {
+                    ai.progress_callback_ = nullptr;
+                    ai.searching_ = false;
+                }
+            } finish { *this };
+            return Search();
+        });
+    } catch (...) {
+        progress_callback_ = nullptr;
+        searching_ = false;
+        throw;
+    }
+    return unique_ptr<SearchHandle>(new SearchHandle(*this, move(result)));
+}
+
+SearchProgress Ai::GetProgress() const {
+    lock_guard<mutex> lock(progress_mutex_);
+    return progress_;
+}
+
+void Ai::ReportProgress(int best_pos, double win_rate, long long playouts, bool done) {
+    //a worker process can't take locks of the parent, it tells the coordinator instead
+    if (shared_stop_ != nullptr) {
+        if (shared_progress_ != nullptr) {
+            shared_progress_[PROCESS_PLAYOUTS].store(static_cast<int32_t>(playouts), memory_order_relaxed);
+            shared_progress_[PROCESS_WIN_RATE].store(static_cast<int32_t>(win_rate * PROCESS_WIN_RATE_SCALE),
+                                                     memory_order_relaxed);
+            shared_progress_[PROCESS_BEST_POS].store(best_pos, memory_order_relaxed);
+        }
+        return;
+    }
+    SearchProgress progress;
+    progress.best_pos = best_pos;
+    progress.win_rate = win_rate;
+    progress.playouts = playouts;
+    progress.done = done;
+    {
+        lock_guard<mutex> lock(progress_mutex_);
+        progress_ = progress;
+    }
+    if (progress_callback_) {
+        progress_callback_(progress);
+    }
+}
+
+//Sets the time limit of the next search, under a game clock from the time left.
+void Ai::StartClock() {
+    if (has_clock_) {
+        double moves_left = max(1.0, board_.GetFreePositions().size() * CLOCK_MOVES_PER_FREE_POSITION);
+        time_budget_ = max(MIN_MOVE_SECONDS, clock_left_ / moves_left);
+    }
+    deadline_ = (chrono::steady_clock::now()
+            + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(time_budget_)))
+            .time_since_epoch().count();
+}
+
+int Ai::Search() {
+    {
+        lock_guard<mutex> lock(progress_mutex_);
+        progress_ = SearchProgress();
+    }
+    live_playouts_ = 0;
+    network_evaluations_ = 0;
+    int move_number = stats_.move + 1;
+    stats_ = SearchStats();
+    stats_.move = move_number;
+    auto start = chrono::steady_clock::now();
+    int pos;
+    {
+        ScopedTimer timer(GetTimer(stats_.total_seconds));
+        pos = ChoosePosition();
+    }
+    if (has_clock_) {
+        //the time that the move didn't use stays for the next ones
+        clock_left_ = max(0.0, clock_left_ - chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    stats_.playouts = static_cast<long long>(simulations_);
+    stats_.sampling_gain = GetSamplingGain();
+    stats_.network_evaluations = network_evaluations_;
+    if (stats_sink_ != nullptr) {
+        *stats_sink_ << stats_.ToJson() << endl;
+    }
+    ReportProgress(pos, pos >= 0 ? max(0.0, move_values_[pos]) : 0, stats_.playouts, true);
+    return pos;
+}
+
+uint32_t Ai::GetNetworkChecksum() const {
+    return network_ ? network_->GetNetwork().GetChecksum() : 0;
+}
+
+double Ai::GetSamplingGain() const {
+    return simulations_ == 0 ? 1 : effective_simulations_ / simulations_;
+}
+
+uint64_t Ai::MakeRandomSeed() {
+    random_device device;
+    return static_cast<uint64_t>(device()) << 32 | device();
+}
 
-    int board_size = board_.GetSize();
-    int row = pos / board_size;
-    int col = pos % board_size;
-    char letter = 'A' + col;
-    string move;
-    move.push_back(letter);
-    move.append(to_string(1 + row));
-    cout << move << endl;
-    return Move(move, board_);
+//Adds to the virtual board the computer's stones that it doesn't have yet. The board
+//decides which moves were played, they might not be the ones that the AI chose.
+void Ai::AddComputerStones() {
+    int total_pos = board_.GetSize() * board_.GetSize();
+    for (int pos = 0; pos < total_pos; pos++) {
+        if (board_.Belongs(pos, player_) && !virtual_board_.IsOccupied(pos)) {
+            virtual_board_.Occupy(pos);
+        }
+    }
 }
 
 //Returns the best position that the AI can find or -1 if it decides to give up.
 int Ai::ChoosePosition() {
+    HEX_TRACE_SPAN("Ai::ChoosePosition");
     unordered_set<int> free_nodes = board_.GetFreePositions();
     assert(free_nodes.size() > 0);
+    AddComputerStones();
+    stats_.board_size = board_.GetSize();
+    stats_.free_positions = static_cast<int>(free_nodes.size());
+    stats_.threads = threads_;
+    move_values_.assign(board_.GetSize() * board_.GetSize(), -1);
     if (free_nodes.size() == 1) {
         //last position free, win game!
         return *free_nodes.begin();
     }
     //eliminate positions too far from the action
-    unordered_set<int> selectable = GetSelectable(board_);
+    unordered_set<int> selectable;
+    {
+        ScopedTimer timer(GetTimer(stats_.selectable_seconds));
+        selectable = GetSelectable(board_);
+    }
+    {
+        ScopedTimer timer(GetTimer(stats_.pruning_seconds));
+        dead_positions_ = InferiorCells::GetDeadPositions(board_);
+        PruneCandidates(selectable);
+    }
     assert(selectable.size() > 0);
 
     int best_pos = -1;
     double win_prob = 0;
-    for (int pos : selectable) {
-        TestOccupyingPos(pos, free_nodes, best_pos, win_prob);
+    simulations_ = effective_simulations_ = 0;
+    //the previous root is two stones away if the opponent answered the last move
+    has_previous_root_ = board_.GetOccupiedPositions().size() == stones_at_root_ + 2;
+    previous_root_key_ = root_key_;
+    root_key_ = Zobrist::GetSymmetricKey(board_);
+    stones_at_root_ = board_.GetOccupiedPositions().size();
+    cache_.NewTurn();
+    //rotated moves lead to the same game on a symmetric board
+    if (root_key_.IsSymmetric()) {
+        RemoveRotatedMoves(selectable, board_.GetSize());
+    }
+    //the most promising positions first make win_prob grow early
+    vector<int> candidates;
+    vector<double> priors;
+    {
+        ScopedTimer timer(GetTimer(stats_.ordering_seconds));
+        if (network_) {
+            candidates = SortByPolicy(evaluator_.GetStones(board_), selectable, player_, &priors);
+        } else {
+            candidates = evaluator_.SortMoves(board_, selectable, player_);
+        }
+    }
+    const size_t max_candidates = GetMaxMoves(MAX_CANDIDATES, board_.GetSize());
+    if (candidates.size() > max_candidates) {
+        candidates.resize(max_candidates);
+        priors.resize(min(priors.size(), max_candidates));
+    }
+    if (processes_ > 1) {
+        best_pos = SearchProcesses(candidates, priors, free_nodes, win_prob);
+    } else if (search_mode_ == SearchMode::SHARED_TREE) {
+        best_pos = SearchSharedTree(candidates, priors, free_nodes, win_prob, pool_, threads_, nullptr);
+    } else {
+        //time of the candidates whose test finished, refuted or not
+        double completed_seconds = 0;
+        int completed = 0;
+        //the worst response of the best move, and the highest upper bound of the others
+        SimulationTally best_tally;
+        double runner_up_bound = 0;
+        int refutations = 0;
+        for (int pos : candidates) {
+            if (IsOutOfTime()) break;
+            //the candidates left are like the runner-up at best, and a test that can't be
+            //completed in time is wasted
+            if (win_prob >= SETTLED_WIN_PROB
+                    || (refutations >= MIN_SETTLED_REFUTATIONS && best_tally.GetLowerBound() > runner_up_bound)
+                    || (time_budget_ > 0 && completed > 0 && GetSecondsLeft() < completed_seconds / completed)) {
+                stats_.stopped_early = true;
+                break;
+            }
+            auto start = chrono::steady_clock::now();
+            int previous_best = best_pos;
+            SimulationTally worst_response = TestOccupyingPos(pos, free_nodes, best_pos, win_prob);
+            //a test cut by the time limit didn't finish
+            if (!IsOutOfTime()) {
+                completed++;
+                completed_seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                if (best_pos == previous_best) {
+                    refutations++;
+                    runner_up_bound = max(runner_up_bound, worst_response.GetUpperBound());
+                } else {
+                    if (previous_best >= 0) {
+                        runner_up_bound = max(runner_up_bound, best_tally.GetUpperBound());
+                    }
+                    best_tally = worst_response;
+                }
+            }
+            if (best_pos >= 0) {
+                ReportProgress(best_pos, win_prob, live_playouts_);
+            }
+        }
+    }
+    if (best_pos < 0 && IsOutOfTime()) {
+        //no move was completed in time, the resistance has the last word
+        stats_.out_of_time = true;
+        return candidates.front();
     }
 
     if (win_prob < GIVE_UP_FACTOR) {
         return -1; //too slim chances, give up
-    } else {
-        //keep the virtual board updated
-        virtual_board_.Occupy(best_pos);
-        return best_pos;
     }
+    return best_pos;
 }
 
 //Tests the result of occupying one position in the board and updates the best_pos and win_prob
 //if it find a winning probability better than the one of the current best position.
 //Uses Alpha-Beta pruning by skipping simulations of branches that the opponent can choose to minimize
 //the AI's winning probability.
-void Ai::TestOccupyingPos(const int pos,
-                          const unordered_set<int>& free_pos,
-                          int& best_pos,
-                          double& win_prob) {
+//Returns the results of the worst response seen, which give the value of the move.
+SimulationTally Ai::TestOccupyingPos(const int pos,
+                                     const unordered_set<int>& free_pos,
+                                     int& best_pos,
+                                     double& win_prob) {
+    HEX_TRACE_SPAN("Ai::TestOccupyingPos");
+    stats_.candidates++;
     unordered_set<int> test_free_pos = free_pos;
     test_free_pos.erase(pos);
     VirtualBoard test_board = virtual_board_;
     test_board.Occupy(pos);
-    unordered_set<int> test_selectable = GetSelectable(test_board); //TODO
-    if (FindBetterChances(test_selectable, test_free_pos, test_board, win_prob)) {
+    vector<int> responses = GetResponses(pos, test_free_pos, test_board,
+                                         GetTimer(stats_.selectable_seconds),
+                                         GetTimer(stats_.ordering_seconds),
+                                         nullptr);
+    Zobrist::SymmetricKey key = root_key_ ^ Zobrist::GetSymmetricKey(pos, player_, board_.GetSize());
+    SimulationTally worst_response;
+    if (FindBetterChances(pos, responses, test_free_pos, test_board, key, win_prob, worst_response)) {
         best_pos = pos;
+    } else if (!IsOutOfTime()) {
+        stats_.refuted_candidates++;
     }
+    move_values_[pos] = worst_response.GetSimulations() > 0 ? worst_response.GetWinRatio() : -1;
+    return worst_response;
 }
 
-//Runs a Monte Carlo simulation for every position that the opponent can choose as a response.
-//Returns false if it brakes the search because it found any win_prob worse than the current win_prob
+//Searches all the candidates at once with a tree that every thread of the pool descends,
+//see SharedTree. Returns the candidate with most simulations and sets win_prob to its win
+//ratio, or returns -1 if the time ran out before any simulation.
+//The results of every candidate are copied to move_results if it isn't null.
+int Ai::SearchSharedTree(const vector<int>& candidates,
+                         const vector<double>& priors,
+                         const unordered_set<int>& free_nodes,
+                         double& win_prob,
+                         ThreadPool& pool,
+                         int threads,
+                         vector<CandidateResults>* move_results) {
+    HEX_TRACE_SPAN("Ai::SearchSharedTree");
+    atomic<int> cached_responses(0);
+    atomic<int> previous_turn_responses(0);
+    //runs in the worker threads, it only reads the AI
+    SharedTree tree(candidates, threads, [&](int pos, SharedTree::Expansion& expansion) {
+        unordered_set<int> test_free_pos = free_nodes;
+        test_free_pos.erase(pos);
+        expansion.board.reset(new VirtualBoard(virtual_board_));
+        expansion.board->Occupy(pos);
+        expansion.responses = GetResponses(pos, test_free_pos, *expansion.board, nullptr, nullptr,
+                                           &expansion.priors);
+        Zobrist::SymmetricKey key = root_key_ ^ Zobrist::GetSymmetricKey(pos, player_, board_.GetSize());
+        int pos_to_fill = test_free_pos.size() / 2;
+        size_t count = expansion.responses.size();
+        vector<SimulationTally> cached(count);
+        vector<SimulationTally> previous(count);
+        for (size_t i = 0; i < count; i++) {
+            KnownResults known = FindKnownResults(key, expansion.responses[i], cached[i], previous[i]);
+            cached_responses += known == KnownResults::CACHED ? 1 : 0;
+            previous_turn_responses += known == KnownResults::PREVIOUS_TURN ? 1 : 0;
+        }
+        //the unvisited responses are descended in their order
+        vector<int> responses;
+        vector<double> response_priors;
+        for (int i : OrderByPreviousTurn(previous)) {
+            responses.push_back(expansion.responses[i]);
+            expansion.cached.push_back(cached[i]);
+            if (!expansion.priors.empty()) response_priors.push_back(expansion.priors[i]);
+        }
+        expansion.responses.swap(responses);
+        expansion.priors.swap(response_priors);
+        expansion.starts = expansion.cached;
+        for (int response : expansion.responses) {
+            vector<int> test_free_nodes;
+            for (int it : test_free_pos) {
+                if (it != response) test_free_nodes.push_back(it);
+            }
+            expansion.simulators.emplace_back(move(test_free_nodes), *expansion.board, pos_to_fill, SAMPLING);
+        }
+        AddNetworkValues(pos, expansion.responses, expansion.starts);
+    }, priors);
+
+    ScopedTimer playout_timer(GetTimer(stats_.playout_seconds));
+    double* busy_seconds = GetTimer(stats_.busy_seconds);
+    atomic<long long> busy_nanoseconds(0);
+    const long long max_simulations = TREE_SIMULATIONS * static_cast<long long>(candidates.size());
+    const uint64_t seed = seed_ ^ root_key_.key;
+    const auto search_start = chrono::steady_clock::now();
+    atomic<bool> settled(false);
+    atomic<chrono::steady_clock::rep> last_report(search_start.time_since_epoch().count());
+    const chrono::steady_clock::rep report_interval = chrono::duration_cast<chrono::steady_clock::duration>(
+            chrono::duration<double>(PROGRESS_INTERVAL)).count();
+    //the search ends when the time is over or the best move can't change with the
+    //simulations left, which the time left can also limit
+    function<bool()> stop = [&]() {
+        if (settled.load(memory_order_relaxed)) return true;
+        if (IsOutOfTime()) return true;
+        //one of the workers reports the progress now and then
+        chrono::steady_clock::rep now = chrono::steady_clock::now().time_since_epoch().count();
+        chrono::steady_clock::rep last = last_report.load(memory_order_relaxed);
+        if (now - last >= report_interval && last_report.compare_exchange_strong(last, now)) {
+            int best = tree.GetBestMove();
+            if (best >= 0) {
+                ReportProgress(tree.GetMove(best), tree.GetWinRatio(best), tree.GetTotalSimulations());
+            }
+        }
+        long long simulations = tree.GetTotalSimulations();
+        long long remaining = max_simulations - simulations;
+        if (time_budget_ > 0) {
+            double elapsed = chrono::duration<double>(chrono::steady_clock::now() - search_start).count();
+            if (elapsed > 0) {
+                remaining = min(remaining, static_cast<long long>(simulations / elapsed * GetSecondsLeft()));
+            }
+        }
+        if (tree.IsSettled(remaining)) {
+            settled = true;
+            return true;
+        }
+        return false;
+    };
+    vector<future<void>> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(pool.enqueue([&tree, &busy_nanoseconds, &stop, max_simulations, seed](int worker) {
+            auto start = chrono::steady_clock::now();
+            tree.Search(worker, max_simulations, seed, stop);
+            busy_nanoseconds += chrono::duration_cast<chrono::nanoseconds>(
+                    chrono::steady_clock::now() - start).count();
+        }, i));
+    }
+    //every worker has to finish before leaving, they use the tree
+    for (future<void>& it : workers) {
+        it.wait();
+    }
+    playout_timer.Stop();
+    if (busy_seconds != nullptr) {
+        *busy_seconds += busy_nanoseconds * 1e-9;
+    }
+    for (future<void>& it : workers) {
+        it.get();
+    }
+    stats_.out_of_time = IsOutOfTime();
+    stats_.stopped_early = settled;
+    stats_.cached_responses += cached_responses;
+    stats_.previous_turn_responses += previous_turn_responses;
+
+    for (int i = 0; i < tree.GetMoveCount(); i++) {
+        const SharedTree::Expansion* expansion = tree.GetExpansion(i);
+        if (expansion == nullptr) continue;
+        stats_.candidates++;
+        stats_.responses += static_cast<int>(expansion->responses.size());
+        int pos = tree.GetMove(i);
+        move_values_[pos] = tree.GetWinRatio(i);
+        Zobrist::SymmetricKey key = root_key_ ^ Zobrist::GetSymmetricKey(pos, player_, board_.GetSize());
+        for (size_t k = 0; k < expansion->responses.size(); k++) {
+            SimulationTally results = tree.GetNewResults(i, k);
+            simulations_ += results.GetSimulations();
+            effective_simulations_ += results.GetEffectiveSimulations();
+            SimulationTally fresh = expansion->cached[k];
+            fresh.Add(results);
+            if (fresh.GetSimulations() > 0) {
+                Zobrist::SymmetricKey response_key = Zobrist::GetSymmetricKey(expansion->responses[k], opponent_,
+                                                                              board_.GetSize());
+                cache_.Store((key ^ response_key).GetCanonical(), fresh);
+            }
+        }
+    }
+    if (move_results != nullptr) {
+        move_results->assign(candidates.size(), CandidateResults());
+        for (int i = 0; i < tree.GetMoveCount(); i++) {
+            const SharedTree::Expansion* expansion = tree.GetExpansion(i);
+            if (expansion == nullptr) continue;
+            CandidateResults& results = (*move_results)[i];
+            for (size_t k = 0; k < expansion->responses.size(); k++) {
+                results.simulated.Add(tree.GetNewResults(i, k));
+                if (k < expansion->starts.size()) {
+                    results.known.Add(expansion->starts[k]);
+                }
+            }
+        }
+    }
+    int best = tree.GetBestMove();
+    if (best < 0) {
+        return -1;
+    }
+    win_prob = tree.GetWinRatio(best);
+    return tree.GetMove(best);
+}
+
+//Forks the worker processes, and each one searches all the candidates with a shared tree and
+//a seed of its own, and writes the results of every candidate to shared memory.
+//The results that the processes ran are added, with the known results of every candidate
+//once, since every process starts from the same ones, and the candidate with most simulations
+//is chosen like in SearchSharedTree. The caches of the processes are lost.
+int Ai::SearchProcesses(const vector<int>& candidates,
+                        const vector<double>& priors,
+                        const unordered_set<int>& free_nodes,
+                        double& win_prob) {
+    HEX_TRACE_SPAN("Ai::SearchProcesses");
+    const size_t block_size = GetProcessBlockSize(candidates.size());
+    SharedMemory memory(PROCESSES_HEADER_SIZE + block_size * processes_);
+    atomic<bool>* stop = new (memory.GetData()) atomic<bool>(false);
+    auto get_block = [&](int process) {
+        return reinterpret_cast<int32_t*>(memory.GetData() + PROCESSES_HEADER_SIZE + block_size * process);
+    };
+    auto get_header = [&](int process) {
+        return reinterpret_cast<atomic<int32_t>*>(get_block(process));
+    };
+    for (int process = 0; process < processes_; process++) {
+        for (size_t i = 0; i < PROCESS_FIELDS; i++) {
+            new (get_block(process) + i) atomic<int32_t>(i == PROCESS_BEST_POS ? -1 : 0);
+        }
+    }
+
+    ScopedTimer playout_timer(GetTimer(stats_.playout_seconds));
+    vector<pid_t> children;
+    for (int process = 0; process < processes_; process++) {
+        pid_t pid = fork();
+        if (pid < 0) break; //the ones already forked do the search
+        if (pid == 0) {
+            //the child only has this thread, it needs a pool of its own
+            int exit_code = 1;
+            try {
+                shared_stop_ = stop;
+                shared_progress_ = get_header(process);
+                progress_callback_ = nullptr;
+                seed_ = MixSeed(seed_, process + 1, 0);
+                ThreadPool pool(threads_per_process_);
+                vector<CandidateResults> results;
+                double process_win_prob = 0;
+                SearchSharedTree(candidates, priors, free_nodes, process_win_prob, pool, threads_per_process_,
+                                 &results);
+                int32_t* block = get_block(process);
+                for (size_t i = 0; i < candidates.size(); i++) {
+                    int32_t* fields = block + PROCESS_FIELDS * (1 + i);
+                    fields[0] = results[i].simulated.GetWins();
+                    fields[1] = results[i].simulated.GetSimulations();
+                    fields[2] = results[i].known.GetWins();
+                    fields[3] = results[i].known.GetSimulations();
+                }
+                get_header(process)[PROCESS_DONE].store(1, memory_order_release);
+                exit_code = 0;
+            } catch (...) {
+            }
+            //nothing of the parent can run here, like its static destructors
+            _exit(exit_code);
+        }
+        children.push_back(pid);
+    }
+    if (children.empty()) {
+        return SearchSharedTree(candidates, priors, free_nodes, win_prob, pool_, threads_, nullptr);
+    }
+
+    //the progress of the search is the move that most processes find best, with their
+    //average win rate, and the playouts of all of them
+    auto report_progress = [&]() {
+        map<int, pair<int, double>> votes;
+        long long playouts = 0;
+        for (size_t process = 0; process < children.size(); process++) {
+            const atomic<int32_t>* header = get_header(process);
+            playouts += header[PROCESS_PLAYOUTS].load(memory_order_relaxed);
+            int pos = header[PROCESS_BEST_POS].load(memory_order_relaxed);
+            if (pos < 0) continue;
+            votes[pos].first++;
+            votes[pos].second += header[PROCESS_WIN_RATE].load(memory_order_relaxed) / PROCESS_WIN_RATE_SCALE;
+        }
+        auto best = votes.end();
+        for (auto it = votes.begin(); it != votes.end(); ++it) {
+            if (best == votes.end() || it->second.first > best->second.first
+                    || (it->second.first == best->second.first && it->second.second > best->second.second)) {
+                best = it;
+            }
+        }
+        if (best != votes.end()) {
+            ReportProgress(best->first, best->second.second / best->second.first, playouts);
+        }
+    };
+
+    //the deadline is the same for all, but a stop has to be passed on, and the processes
+    //that don't stop in time are killed
+    vector<bool> running(children.size(), true);
+    size_t left = children.size();
+    auto last_report = chrono::steady_clock::now();
+    chrono::steady_clock::time_point kill_time;
+    while (left > 0) {
+        if (!*stop && IsOutOfTime()) {
+            *stop = true;
+            kill_time = chrono::steady_clock::now()
+                    + chrono::duration_cast<chrono::steady_clock::duration>(
+                            chrono::duration<double>(PROCESS_GRACE_SECONDS));
+        }
+        const bool kill_running = *stop && chrono::steady_clock::now() >= kill_time;
+        for (size_t i = 0; i < children.size(); i++) {
+            if (!running[i]) continue;
+            int status;
+            if (kill_running) {
+                kill(children[i], SIGKILL);
+                waitpid(children[i], &status, 0);
+            } else if (waitpid(children[i], &status, WNOHANG) == 0) {
+                continue;
+            }
+            running[i] = false;
+            left--;
+        }
+        if (left > 0) {
+            if (chrono::duration<double>(chrono::steady_clock::now() - last_report).count() >= PROGRESS_INTERVAL) {
+                last_report = chrono::steady_clock::now();
+                report_progress();
+            }
+            this_thread::sleep_for(chrono::duration<double>(PROCESS_POLL_SECONDS));
+        }
+    }
+    playout_timer.Stop();
+
+    vector<SimulationTally> simulated(candidates.size());
+    vector<SimulationTally> known(candidates.size());
+    for (size_t process = 0; process < children.size(); process++) {
+        if (get_header(process)[PROCESS_DONE].load(memory_order_acquire) == 0) continue; //it failed or was killed
+        const int32_t* block = get_block(process);
+        for (size_t i = 0; i < candidates.size(); i++) {
+            const int32_t* fields = block + PROCESS_FIELDS * (1 + i);
+            if (fields[1] > 0) {
+                simulated[i].AddIndependent(fields[0], fields[1]);
+            }
+            //the processes that expanded the candidate found the same known results
+            if (fields[3] > 0 && known[i].GetSimulations() == 0) {
+                known[i].AddIndependent(fields[2], fields[3]);
+            }
+        }
+    }
+    stats_.out_of_time = IsOutOfTime();
+    vector<SimulationTally> merged = known;
+    int best = -1;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        merged[i].Add(simulated[i]);
+        int simulations = merged[i].GetSimulations();
+        if (simulations == 0) continue;
+        stats_.candidates++;
+        simulations_ += simulated[i].GetSimulations();
+        effective_simulations_ += simulated[i].GetSimulations();
+        move_values_[candidates[i]] = merged[i].GetWinRatio();
+        if (best < 0 || simulations > merged[best].GetSimulations()) {
+            best = static_cast<int>(i);
+        }
+    }
+    if (best < 0) {
+        return -1;
+    }
+    win_prob = merged[best].GetWinRatio();
+    return candidates[best];
+}
+
+//Returns the opponent's responses to a move worth simulating, from the best to the worst
+//for the opponent. The timers get the time spent choosing and sorting them if they aren't null.
+//The priors get the probabilities of the responses if there is a network and they aren't null.
+vector<int> Ai::GetResponses(int pos,
+                             const unordered_set<int>& test_free_pos,
+                             const VirtualBoard& test_board,
+                             double* selectable_seconds,
+                             double* ordering_seconds,
+                             vector<double>* priors) const {
+    unordered_set<int> test_selectable;
+    {
+        ScopedTimer timer(selectable_seconds);
+        test_selectable = GetSelectable(test_board); //TODO
+    }
+    //the virtual board doesn't know the opponent's stones
+    for (auto it = test_selectable.begin(); it != test_selectable.end();) {
+        it = test_free_pos.count(*it) == 0 ? test_selectable.erase(it) : next(it);
+    }
+    if (test_selectable.empty()) {
+        test_selectable = test_free_pos;
+    }
+    //a dead position is never a better answer than any other
+    RemoveDeadPositions(test_selectable);
+    //after a move in the center the board can still be symmetric
+    if ((root_key_ ^ Zobrist::GetSymmetricKey(pos, player_, board_.GetSize())).IsSymmetric()) {
+        RemoveRotatedMoves(test_selectable, board_.GetSize());
+    }
+    //the opponent's best responses first, they are the ones that can prune the branch
+    vector<int> stones = evaluator_.GetStones(board_);
+    stones[pos] = player_.GetId();
+    vector<int> responses;
+    const size_t max_responses = GetMaxMoves(MAX_RESPONSES, board_.GetSize());
+    ScopedTimer ordering_timer(ordering_seconds);
+    if (network_) {
+        vector<double> policy;
+        responses = SortByPolicy(stones, test_selectable, opponent_, &policy);
+        if (responses.size() > max_responses) {
+            responses.resize(max_responses);
+            policy.resize(max_responses);
+        }
+        if (priors != nullptr) {
+            *priors = move(policy);
+        }
+    } else if (test_selectable.size() > max_responses) {
+        //too many to evaluate each one, the opponent's current shows where it needs to play
+        responses = evaluator_.SortByCurrent(stones, board_.GetSize(), test_selectable, opponent_);
+        responses.resize(max_responses);
+    } else {
+        responses = evaluator_.SortMoves(stones, board_.GetSize(), test_selectable, opponent_);
+    }
+    return responses;
+}
+
+//Returns the positions sorted from the most to the least probable for the player according
+//to the policy of the network, and their probabilities in priors.
+vector<int> Ai::SortByPolicy(const vector<int>& stones,
+                             const unordered_set<int>& positions,
+                             const Player& player,
+                             vector<double>* priors) const {
+    vector<NeuralNetwork::Input> inputs(1, NeuralNetwork::Input { stones, board_.GetSize(), &player });
+    vector<float> policy = EvaluatePositions(move(inputs)).front().policy;
+    vector<int> sorted(positions.begin(), positions.end());
+    //ties are broken by position, the set has no order
+    sort(sorted.begin(), sorted.end(), [&policy](int first, int second) {
+        return policy[first] > policy[second] || (policy[first] == policy[second] && first < second);
+    });
+    priors->clear();
+    for (int pos : sorted) {
+        priors->push_back(policy[pos]);
+    }
+    return sorted;
+}
+
+//Gives the responses with no known results the network's value of the position after
+//them, as if it was some simulations. Does nothing without a network.
+void Ai::AddNetworkValues(int pos, const vector<int>& responses, vector<SimulationTally>& tallies) const {
+    if (!network_) return;
+    vector<int> stones = evaluator_.GetStones(board_);
+    stones[pos] = player_.GetId();
+    vector<NeuralNetwork::Input> inputs;
+    vector<size_t> unknown;
+    for (size_t i = 0; i < responses.size(); i++) {
+        if (tallies[i].GetSimulations() > 0) continue;
+        inputs.push_back(NeuralNetwork::Input { stones, board_.GetSize(), &player_ });
+        inputs.back().stones[responses[i]] = opponent_.GetId();
+        unknown.push_back(i);
+    }
+    vector<NeuralNetwork::Output> outputs = EvaluatePositions(move(inputs));
+    for (size_t k = 0; k < outputs.size(); k++) {
+        //the computer moves next, so the value is its chances
+        int wins = static_cast<int>(outputs[k].value * NETWORK_SIMULATIONS + 0.5);
+        tallies[unknown[k]].AddIndependent(wins, NETWORK_SIMULATIONS);
+    }
+}
+
+//Evaluates the positions with the batches of the network. A worker process evaluates them
+//on its own, it doesn't have the thread of the batches.
+vector<NeuralNetwork::Output> Ai::EvaluatePositions(vector<NeuralNetwork::Input> inputs) const {
+    network_evaluations_ += inputs.size();
+    if (shared_stop_ != nullptr) {
+        return network_->GetNetwork().Evaluate(inputs);
+    }
+    return network_->Evaluate(move(inputs));
+}
+
+//Looks for the results of a response in the cache, or else for the results of the same
+//moves from the root of the previous turn. That position lacks the last two stones, so its
+//results only tell the order of the responses and never count as results of this one.
+Ai::KnownResults Ai::FindKnownResults(const Zobrist::SymmetricKey& test_key,
+                                      int response,
+                                      SimulationTally& cached,
+                                      SimulationTally& previous) const {
+    Zobrist::SymmetricKey response_key = Zobrist::GetSymmetricKey(response, opponent_, board_.GetSize());
+    if (cache_.Find((test_key ^ response_key).GetCanonical(), cached)) {
+        return KnownResults::CACHED;
+    } else if (has_previous_root_
+            && cache_.Find((test_key ^ root_key_ ^ previous_root_key_ ^ response_key).GetCanonical(),
+                           previous)) {
+        return KnownResults::PREVIOUS_TURN;
+    }
+    return KnownResults::NONE;
+}
+
+//Runs Monte Carlo simulations for every position that the opponent can choose as a response.
+//The simulations run in rounds and the responses whose win ratio is clearly higher than
+//the worst one are dropped after every round, since the opponent won't choose them.
+//Responses start from the cached results of the same position, or else from the network's
+//value, and the ones that were the worst in the previous turn are simulated first.
+//Returns false as soon as it finds a win ratio worse than the current win_prob
 //(because the opponent can choose that branch to minimize the AI's winning ratio)
 //Returns true if completes, so the explored branch is better and the win_prob gets updated.
-bool Ai::FindBetterChances(const unordered_set<int>& selectable,
+bool Ai::FindBetterChances(int candidate,
+                           const vector<int>& selectable,
                            const unordered_set<int>& free_pos,
                            const VirtualBoard& test_board,
-                           double& win_prob) const {
+                           const Zobrist::SymmetricKey& test_key,
+                           double& win_prob,
+                           SimulationTally& worst_response) {
+    HEX_TRACE_SPAN("Ai::FindBetterChances");
     //The M C simulations will randomly fill half of the board,
     //we calculate how many positions that is.
     //One free position is for the opponent.
     int pos_to_fill = free_pos.size() / 2;
-    abort_sim = false;
-    deque<future<double>> tasks;
-    int max_threads = 4;
-    //int max_threads = thread::hardware_concurrency();
-    //if (max_threads == 0) max_threads = 2;
-    ThreadPool pool(max_threads);
-    for (int pos : selectable) {
-        tasks.push_back(pool.enqueue(GetMonteCarloWinRatio,
-                                       pos,
-                                       free_pos,
-                                       cref(test_board),
-                                       pos_to_fill));
-    }
-    set<double> win_ratios;
-    for (auto& it : tasks) {
-        double win_ratio = it.get();
-        if (win_ratio < win_prob) {
+    vector<Simulator> simulators;
+    vector<SimulationTally> tallies(selectable.size());
+    vector<SimulationTally> fresh(selectable.size()); //without the network's values
+    vector<SimulationTally> previous(selectable.size());
+    vector<int> racing; //indexes of the responses that can still be the worst
+    vector<int> finished; //indexes of the responses that used all their simulations
+    for (size_t i = 0; i < selectable.size(); i++) {
+        vector<int> free_nodes;
+        for (int pos : free_pos) {
+            if (pos != selectable[i]) free_nodes.push_back(pos);
+        }
+        simulators.emplace_back(move(free_nodes), test_board, pos_to_fill, SAMPLING);
+        KnownResults known = FindKnownResults(test_key, selectable[i], fresh[i], previous[i]);
+        tallies[i] = fresh[i];
+        stats_.cached_responses += known == KnownResults::CACHED ? 1 : 0;
+        stats_.previous_turn_responses += known == KnownResults::PREVIOUS_TURN ? 1 : 0;
+    }
+    //a refutation found early stops the round
+    racing = OrderByPreviousTurn(previous);
+    AddNetworkValues(candidate, selectable, tallies);
+    stats_.responses += static_cast<int>(selectable.size());
+
+    ScopedTimer playout_timer(GetTimer(stats_.playout_seconds));
+    double* busy_seconds = GetTimer(stats_.busy_seconds);
+    atomic<long long> busy_nanoseconds(0);
+    atomic<bool> abort_sim(false);
+    for (int round = 0; !racing.empty() && !abort_sim; round++) {
+        if (IsOutOfTime()) {
+            stats_.out_of_time = true;
             abort_sim = true;
-            return false;
+            break;
+        }
+        deque<future<SimulationTally>> tasks;
+        for (int i : racing) {
+            const Simulator& simulator = simulators[i];
+            int simulations = min(ROUND_SIMULATIONS, SIMULATIONS - tallies[i].GetSimulations());
+            uint64_t seed = MixSeed(seed_ ^ test_key.key, i, round);
+            tasks.push_back(pool_.enqueue([&simulator, &abort_sim, &busy_nanoseconds, busy_seconds, seed](int simulations) {
+                if (busy_seconds == nullptr) {
+                    return simulator.Run(simulations, abort_sim, seed);
+                }
+                auto start = chrono::steady_clock::now();
+                SimulationTally result = simulator.Run(simulations, abort_sim, seed);
+                busy_nanoseconds += chrono::duration_cast<chrono::nanoseconds>(
+                        chrono::steady_clock::now() - start).count();
+                return result;
+            }, simulations));
+        }
+        //every task has to finish before leaving, they use local variables
+        //the tasks after a refutation may stop at any point, so their results are
+        //dropped to keep the search the same for the same seed
+        long long round_playouts = 0;
+        for (size_t k = 0; k < tasks.size(); k++) {
+            SimulationTally result = tasks[k].get();
+            live_playouts_ += result.GetSimulations();
+            if (abort_sim) {
+                round_playouts += result.GetSimulations();
+                continue;
+            }
+            tallies[racing[k]].Add(result);
+            fresh[racing[k]].Add(result);
+            round_playouts += result.GetSimulations();
+            if (IsRefutation(tallies[racing[k]], win_prob)) {
+                abort_sim = true;
+                //only the refuting response was needed in this round
+                round_playouts -= result.GetSimulations();
+            }
+        }
+        if (abort_sim) {
+            stats_.wasted_playouts += round_playouts;
+            break;
+        }
+
+        double worst_bound = 1;
+        for (int i : racing) {
+            worst_bound = min(worst_bound, tallies[i].GetUpperBound());
+        }
+        for (int i : finished) {
+            worst_bound = min(worst_bound, tallies[i].GetUpperBound());
         }
-        win_ratios.insert(win_ratio);
+        vector<int> next_racing;
+        for (int i : racing) {
+            if (tallies[i].GetSimulations() >= SIMULATIONS) {
+                finished.push_back(i);
+            } else if (tallies[i].GetLowerBound() <= worst_bound) {
+                next_racing.push_back(i);
+            } else {
+                stats_.dropped_responses++;
+            }
+        }
+        racing.swap(next_racing);
+    }
+    playout_timer.Stop();
+    if (busy_seconds != nullptr) {
+        *busy_seconds += busy_nanoseconds * 1e-9;
+    }
+    for (size_t i = 0; i < selectable.size(); i++) {
+        simulations_ += fresh[i].GetSimulations();
+        effective_simulations_ += fresh[i].GetEffectiveSimulations();
+        if (fresh[i].GetSimulations() > 0) {
+            Zobrist::SymmetricKey response_key = Zobrist::GetSymmetricKey(selectable[i], opponent_, board_.GetSize());
+            cache_.Store((test_key ^ response_key).GetCanonical(), fresh[i]);
+        }
+    }
+    if (abort_sim) {
+        //the response that refuted the move is the worst one seen
+        for (const SimulationTally& tally : tallies) {
+            if (tally.GetSimulations() > 0
+                    && (worst_response.GetSimulations() == 0 || tally.GetWinRatio() < worst_response.GetWinRatio())) {
+                worst_response = tally;
+            }
+        }
+        return false;
     }
     //All the win ratios were higher than the current one,
     //we replace it by the lowest one we find
     //(since the opponent will try to minimize the AI's chances).
-    win_prob = *win_ratios.begin();
+    for (int i : finished) {
+        if (worst_response.GetSimulations() == 0 || tallies[i].GetWinRatio() < worst_response.GetWinRatio()) {
+            worst_response = tallies[i];
+        }
+    }
+    win_prob = worst_response.GetSimulations() > 0 ? worst_response.GetWinRatio() : 1;
     return true;
 }
 
@@ -191,27 +1077,53 @@ bool Ai::FindBetterChances(const unordered_set<int>& selectable,
 //selectable.
 unordered_set<int> Ai::GetSelectable(const AbstractBoard& board) const {
     const int board_size = board_.GetSize();
-    Graph<int> graph(board_size * board_size);
+    const int total_pos = board_size * board_size;
     //center is always selectable even if not yet occupied
     //if board_size is even, center will be off a bit, doesn't matter
     int middle = board_size / 2;
     int center_pos = middle * board_size + middle;
-    //connect center to the 6 positions around it
-    AddSurroundingEdges(center_pos, board_size, graph);
-    //connect also all occupied positions and their neighbors
-    unordered_set<int> occupied = board.GetOccupiedPositions();
-    for (int node : occupied) {
-        AddSurroundingEdges(node, board_size, graph);
-    }
-    unordered_set<int> selectable = graph.GetReachable(center_pos);
-    //increase the selectable by adding another level of neighbors
-    for (int node : selectable) {
-        AddSurroundingEdges(node, board_size, graph);
+    //two neighbors are connected if any of them is a hub: the center or an occupied position
+    CellSet occupied;
+    for (int node : board.GetOccupiedPositions()) {
+        occupied.set(node);
     }
-    selectable = graph.GetReachable(center_pos);
-    selectable.insert(center_pos);
+    CellSet hubs = occupied;
+    hubs.set(center_pos);
+    BoardMasks masks = MakeMasks(board_size);
+    CellSet reached = GetReachableFrom(center_pos, hubs, masks, board_size);
+    //increase the selectable by adding another level of neighbors
+    reached = GetReachableFrom(center_pos, hubs | reached, masks, board_size);
     //remove all occupied nodes
-    for (int node : occupied)
-        selectable.erase(node);
+    reached &= ~occupied;
+    unordered_set<int> selectable;
+    for (int node = 0; node < total_pos; node++) {
+        if (reached.test(node)) {
+            selectable.insert(node);
+        }
+    }
     return selectable;
 }
+
+//Keeps only the positions that break the opponent's winning threat, if it has any,
+//and removes the dead positions.
+void Ai::PruneCandidates(unordered_set<int>& selectable) const {
+    VirtualConnections opponent_connections(board_, opponent_);
+    unordered_set<int> must_play = opponent_connections.GetMustPlay();
+    if (!must_play.empty()) {
+        selectable = must_play;
+    }
+    RemoveDeadPositions(selectable);
+}
+
+//Removes the dead positions unless all of them are dead.
+void Ai::RemoveDeadPositions(unordered_set<int>& selectable) const {
+    unordered_set<int> alive;
+    for (int pos : selectable) {
+        if (dead_positions_.count(pos) == 0) {
+            alive.insert(pos);
+        }
+    }
+    if (!alive.empty()) {
+        selectable.swap(alive);
+    }
+}
@@ -1,25 +1,72 @@
 #ifndef __Hex_AI__AI__
 #define __Hex_AI__AI__
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <unordered_set>
+#include <vector>
 
 #include "Player.h"
 #include "Board.h"
+#include "NeuralNetwork.h"
+#include "Resistance.h"
+#include "SearchCache.h"
+#include "SearchStats.h"
+#include "ThreadPool.h"
 #include "VirtualBoard.h"
+#include "Zobrist.h"
 
 class AbstractBoard;
 class Move;
+class NeuralBatcher;
+class PersistentCache;
+class SearchHandle;
 class VirtualBoard;
 
+/*
+ * What a search has found so far.
+ */
+struct SearchProgress {
+    //best move until now, -1 before the first one and if the AI gives up
+    int best_pos = -1;
+    //computer's win ratio after the best move
+    double win_rate = 0;
+    long long playouts = 0;
+    bool done = false;
+};
+
+//Receives the progress of a search, from one of the threads that run it at a time.
+typedef std::function<void(const SearchProgress&)> ProgressCallback;
+
+/*
+ * How the AI searches its moves.
+ * PRUNING      Tests the candidates one by one, and stops testing a candidate as soon
+ *              as one response shows that it is worse than the best one so far.
+ *              The threads simulate the responses of one candidate at a time.
+ * SHARED_TREE  All the threads descend a tree of candidates and responses at the same
+ *              time, with no wait between candidates, see SharedTree. The chosen move
+ *              is the one with most simulations. It can't be replayed with more than
+ *              one thread, since the threads race for the tree.
+ */
+enum class SearchMode {
+    PRUNING, SHARED_TREE
+};
+
 /*
  This class returns computer generated Moves
  It simulates the moves that the computer's opponent can make in response
  to every possible computer movement.
- It estimates results by running a Monte Carlo simulation of 1000 outcomes.
+ It estimates results by running a Monte Carlo simulation of up to 1100 outcomes.
  
  Hence for n free positions,
- there are (n)(n-1)(1000) outcomes simulated
+ there are at most (n)(n-1)(1100) outcomes simulated
  
  To reduce the number of simulations two things are done:
  1. (Alpha–beta pruning) For each of the computer possible moves, if an opponent
@@ -27,36 +74,293 @@ class VirtualBoard;
  for that computer possible move are stopped.
  2. Only positions that have at least one occupied position in the neighbors of 
  its neighbors are considered. The center of the board is always considered.
+ 3. Dead positions are never considered, and if the opponent has a virtual connection
+ that only needs one more move to win, only the positions that break it are considered.
+ The computer moves and the opponent responses are tested from the best to the worst
+ according to the resistance of the board, so that pruning happens as early as possible.
+ 4. The results of every opponent response are cached. The search is two moves deep, so
+ nothing was simulated below the position that the last two moves reached, and the
+ previous turn only orders the responses: the ones that were the worst for the computer
+ after the same move are simulated first, since they are the likeliest refutations, but
+ their results of then don't count since the position has two more stones now. The cache
+ can be kept in a file that outlives the process and is shared with other processes.
+ 5. On boards bigger than 14, only the 40 best moves and responses according to the
+ resistance are simulated, so that big boards take about as long as the medium ones.
+ 6. A board rotated 180 degrees is the same game. If the board is the same after the
+ rotation, only one of every two rotated moves is tested, and the cache keeps one entry
+ for both rotations of every position.
+ 7. The search stops when the chosen move can't change anymore: when it is clearly won,
+ when the confidence interval of its win ratio is above the ones of the other moves,
+ when no other move can catch up with the simulations or the time left, or when there
+ is no time to complete another candidate. Under a game clock the saved time is kept
+ for the next moves.
+ 8. With a network, its policy sorts the moves and responses instead of the resistance,
+ and guides the shared tree. Its value of the position after every response counts as
+ some simulations, so the responses that matter get the simulations sooner.
  */
 class Ai {
 public:
+    static const int MAX_THREADS = 4;
+
     /**
      * board            The game's board
      * computer_first   True if the computer makes the first move
      */
     Ai(Board& board, bool computer_first) :
-            board_(board), virtual_board_(board.GetSize(), computer_first) {
+            board_(board),
+            player_(computer_first ? Player::BLUE_PLAYER : Player::RED_PLAYER),
+            opponent_(computer_first ? Player::RED_PLAYER : Player::BLUE_PLAYER),
+            virtual_board_(board.GetSize(), computer_first),
+            own_pool_(new ThreadPool(MAX_THREADS)),
+            pool_(*own_pool_),
+            threads_(MAX_THREADS) {
+        AddComputerStones();
+    }
+    /**
+     * Same as above, but the simulations run in a pool shared with other AIs.
+     * threads      The threads of the pool
+     */
+    Ai(Board& board, bool computer_first, ThreadPool& pool, int threads) :
+            board_(board),
+            player_(computer_first ? Player::BLUE_PLAYER : Player::RED_PLAYER),
+            opponent_(computer_first ? Player::RED_PLAYER : Player::BLUE_PLAYER),
+            virtual_board_(board.GetSize(), computer_first),
+            pool_(pool),
+            threads_(threads) {
+        AddComputerStones();
     }
 
     //Runs a Monte Carlo simulation to compute the next move.
     Move ComputeMove();
+    //Same as ComputeMove, but returns the position, or -1 if the AI gives up.
+    //Throws std::logic_error if a search started with StartSearch is still running.
+    int ComputePosition();
+    /*
+     * Starts computing the next move in another thread and returns at once.
+     * The handle polls the progress, stops or extends the search and waits for the move.
+     * The callback, if any, gets the progress every time the best move changes or
+     * its results grow, and once more when the search is done.
+     * The board must not change until the search is done, and only one search runs at a time:
+     * throws std::logic_error if another one is still running.
+     */
+    std::unique_ptr<SearchHandle> StartSearch(ProgressCallback callback = nullptr);
+    //Returns the progress of the current or the last search. Can be called from any thread.
+    SearchProgress GetProgress() const;
+    //Makes the current search end as soon as possible with the best move found.
+    //Can be called from any thread.
+    void StopSearch() {
+        stop_requested_ = true;
+    }
+    //Moves the time limit of the current search later. Does nothing without a time limit.
+    //Can be called from any thread.
+    void ExtendSearch(double seconds) {
+        deadline_ += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(seconds)).count();
+    }
+    //Limits the time of every move, the search stops after it and keeps the best
+    //move found until then. 0 means no limit.
+    void SetTimeBudget(double seconds) {
+        time_budget_ = seconds;
+        has_clock_ = false;
+    }
+    //Plays under a clock for the whole game instead: every move gets part of the time
+    //left, and the time that easy moves don't use is left for the hard ones.
+    void SetGameClock(double seconds) {
+        clock_left_ = seconds;
+        has_clock_ = true;
+    }
+    double GetClockLeft() const {
+        return clock_left_;
+    }
+    bool HasGameClock() const {
+        return has_clock_;
+    }
+    //The simulations of a position draw the same fillings for the same seed, so a game
+    //can be replayed. Without a time budget the same seed gives the same moves, except in
+    //the SHARED_TREE mode with more than one thread, where the threads race for the tree.
+    void SetSeed(uint64_t seed) {
+        seed_ = seed;
+    }
+    uint64_t GetSeed() const {
+        return seed_;
+    }
+    void SetSearchMode(SearchMode mode) {
+        search_mode_ = mode;
+    }
+    SearchMode GetSearchMode() const {
+        return search_mode_;
+    }
+    /*
+     * Searches with worker processes instead of threads when there is more than one.
+     * Every process searches the same position with a shared tree and its own seed, and
+     * the results of every move are added up in shared memory (Linux only).
+     * The processes are forked by the search, so the AI must not share its pool or run
+     * while other threads of the program hold locks.
+     * threads_per_process  Threads of the shared tree search of every process
+     */
+    void SetProcesses(int processes, int threads_per_process = 1) {
+        processes_ = processes;
+        threads_per_process_ = threads_per_process;
+    }
+    int GetProcesses() const {
+        return processes_;
+    }
+    int GetThreadsPerProcess() const {
+        return threads_per_process_;
+    }
+    //Evaluates the positions with a network, see point 8. Null stops using it.
+    void SetNetwork(std::shared_ptr<NeuralBatcher> network) {
+        network_ = std::move(network);
+    }
+    //Returns the checksum of the network, see NeuralNetwork::GetChecksum, or 0 without one.
+    uint32_t GetNetworkChecksum() const;
+    //Keeps the results of the simulations in a file shared with other processes, so that
+    //the next process starts with them, see PersistentCache. The moves don't only depend
+    //on the seed anymore, since the results of other games change the search.
+    void SetPersistentCache(std::shared_ptr<PersistentCache> cache) {
+        cache_.SetPersistentCache(std::move(cache), board_.GetSize());
+    }
+    bool HasPersistentCache() const {
+        return cache_.HasPersistentCache();
+    }
+    //Returns how many independent simulations each simulation of the last move
+    //was worth, thanks to the sampling mode.
+    double GetSamplingGain() const;
+    //Writes the stats of every move as a line of JSON to the sink, or stops if it is null.
+    //The search is only timed while there is a sink.
+    void SetStatsSink(std::ostream* sink) {
+        stats_sink_ = sink;
+    }
+    const SearchStats& GetLastStats() const {
+        return stats_;
+    }
+    //Returns the computer's win ratio after every move tested in the last search, or -1
+    //for the positions not tested. Moves that were refuted get the win ratio of the worst
+    //response seen, which is enough to know that they were worse than the chosen one.
+    const std::vector<double>& GetMoveValues() const {
+        return move_values_;
+    }
 private:
+    enum class KnownResults {
+        NONE, CACHED, PREVIOUS_TURN
+    };
+    //Results of a candidate after a search: the simulations that the search ran, and the
+    //results of its responses known before, from the cache or the network.
+    struct CandidateResults {
+        SimulationTally simulated;
+        SimulationTally known;
+    };
+
+    static uint64_t MakeRandomSeed();
+    void StartClock();
+    int Search();
+    void AddComputerStones();
     int ChoosePosition();
-    void TestOccupyingPos(const int pos,
-                           const std::unordered_set<int>& free_pos,
-                           int& best_pos,
-                           double& win_prob);
-    bool FindBetterChances(const std::unordered_set<int>& selectable,
+    SimulationTally TestOccupyingPos(const int pos,
+                                     const std::unordered_set<int>& free_pos,
+                                     int& best_pos,
+                                     double& win_prob);
+    bool FindBetterChances(int candidate,
+                           const std::vector<int>& selectable,
                            const std::unordered_set<int>& free_pos,
                            const VirtualBoard& test_board,
-                           double& win_prob) const;
+                           const Zobrist::SymmetricKey& test_key,
+                           double& win_prob,
+                           SimulationTally& worst_response);
+    int SearchSharedTree(const std::vector<int>& candidates,
+                         const std::vector<double>& priors,
+                         const std::unordered_set<int>& free_nodes,
+                         double& win_prob,
+                         ThreadPool& pool,
+                         int threads,
+                         std::vector<CandidateResults>* move_results);
+    int SearchProcesses(const std::vector<int>& candidates,
+                        const std::vector<double>& priors,
+                        const std::unordered_set<int>& free_nodes,
+                        double& win_prob);
+    std::vector<int> GetResponses(int pos,
+                                  const std::unordered_set<int>& test_free_pos,
+                                  const VirtualBoard& test_board,
+                                  double* selectable_seconds,
+                                  double* ordering_seconds,
+                                  std::vector<double>* priors) const;
+    std::vector<int> SortByPolicy(const std::vector<int>& stones,
+                                  const std::unordered_set<int>& positions,
+                                  const Player& player,
+                                  std::vector<double>* priors) const;
+    void AddNetworkValues(int pos, const std::vector<int>& responses, std::vector<SimulationTally>& tallies) const;
+    std::vector<NeuralNetwork::Output> EvaluatePositions(std::vector<NeuralNetwork::Input> inputs) const;
+    KnownResults FindKnownResults(const Zobrist::SymmetricKey& test_key,
+                                  int response,
+                                  SimulationTally& cached,
+                                  SimulationTally& previous) const;
     std::unordered_set<int> GetSelectable(const AbstractBoard& board) const;
+    void PruneCandidates(std::unordered_set<int>& selectable) const;
+    void RemoveDeadPositions(std::unordered_set<int>& selectable) const;
+    void ReportProgress(int best_pos, double win_rate, long long playouts, bool done = false);
+    //Returns true if the time is over or the search was stopped.
+    bool IsOutOfTime() const {
+        return stop_requested_ || (shared_stop_ != nullptr && *shared_stop_)
+                || (time_budget_ > 0 && std::chrono::steady_clock::now().time_since_epoch().count() > deadline_);
+    }
+    double GetSecondsLeft() const {
+        std::chrono::steady_clock::duration left(deadline_ - std::chrono::steady_clock::now().time_since_epoch().count());
+        return std::chrono::duration<double>(left).count();
+    }
+    //Returns where a ScopedTimer adds the time, null if the stats are not written.
+    double* GetTimer(double& seconds) {
+        return stats_sink_ != nullptr ? &seconds : nullptr;
+    }
 
     Board& board_;
+    const Player& player_;
+    const Player& opponent_;
+    //free positions of the board in which no stone can change the result
+    std::unordered_set<int> dead_positions_;
+    ResistanceEvaluator evaluator_;
     //we keep a virtual board with the current occupied positions
     //by the computer, so that we don't have
-    //to initialize it every time we ComputeMove()
+    //to initialize it every time we ComputeMove(), only add the new stones
     VirtualBoard virtual_board_;
+    //results of the simulations kept between turns
+    SearchCache cache_;
+    //Zobrist keys of the board when this turn and the previous one started
+    Zobrist::SymmetricKey root_key_;
+    Zobrist::SymmetricKey previous_root_key_;
+    size_t stones_at_root_ = 0;
+    bool has_previous_root_ = false;
+    //simulations of the last move and their effective amount
+    double simulations_ = 0;
+    double effective_simulations_ = 0;
+    SearchStats stats_;
+    std::vector<double> move_values_;
+    std::ostream* stats_sink_ = nullptr;
+    double time_budget_ = 0;
+    bool has_clock_ = false;
+    double clock_left_ = 0;
+    uint64_t seed_ = MakeRandomSeed();
+    SearchMode search_mode_ = SearchMode::PRUNING;
+    //ticks of the steady clock, it can be extended during the search
+    std::atomic<std::chrono::steady_clock::rep> deadline_ { 0 };
+    std::atomic<bool> stop_requested_ { false };
+    //the stop of the coordinator, in the worker processes
+    const std::atomic<bool>* shared_stop_ = nullptr;
+    //where a worker process tells the coordinator how its search goes
+    std::atomic<int32_t>* shared_progress_ = nullptr;
+    int processes_ = 1;
+    int threads_per_process_ = 1;
+    std::shared_ptr<NeuralBatcher> network_;
+    mutable std::atomic<long long> network_evaluations_ { 0 };
+    //playouts of the current search, as they finish
+    std::atomic<long long> live_playouts_ { 0 };
+    mutable std::mutex progress_mutex_;
+    SearchProgress progress_;
+    ProgressCallback progress_callback_;
+    std::atomic<bool> searching_ { false };
+    //runs the simulations of the opponent responses, owned unless it is shared
+    std::unique_ptr<ThreadPool> own_pool_;
+    ThreadPool& pool_;
+    int threads_;
 };
 
 #endif /* defined(__Hex_AI__AI__) */
@@ -0,0 +1,132 @@
+#include "BatchAnalyzer.h"
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "Ai.h"
+#include "Board.h"
+#include "HexConst.h"
+#include "Move.h"
+#include "Player.h"
+
+using namespace std;
+
+namespace {
+
+    //The messages are fixed, the text of the line never gets into the JSON.
+    string GetError(int line_number, const string& message) {
+        return "{\"line\":" + to_string(line_number) + ",\"error\":\"" + message + "\"}";
+    }
+    string GetError(int line_number, size_t column, const string& message) {
+        return "{\"line\":" + to_string(line_number) + ",\"column\":" + to_string(column)
+                + ",\"error\":\"" + message + "\"}";
+    }
+}
+
+BatchAnalyzer::BatchAnalyzer(istream& in, ostream& out, int threads, int budget_ms) :
+        in_(in),
+        out_(out),
+        threads_(threads),
+        budget_ms_(budget_ms),
+        pool_(threads) {
+}
+
+int BatchAnalyzer::Run() {
+    vector<thread> workers;
+    for (int i = 0; i < threads_; i++) {
+        workers.emplace_back(&BatchAnalyzer::Work, this);
+    }
+    for (thread& it : workers) {
+        it.join();
+    }
+    return errors_;
+}
+
+void BatchAnalyzer::Work() {
+    string position;
+    int line_number;
+    while (ReadPosition(position, line_number)) {
+        string result;
+        bool analyzed = Analyze(position, line_number, result);
+        Write(result, analyzed);
+    }
+}
+
+bool BatchAnalyzer::ReadPosition(string& position, int& line_number) {
+    lock_guard<mutex> lock(in_mutex_);
+    while (getline(in_, position)) {
+        line_number = ++lines_read_;
+        size_t start = position.find_first_not_of(" \t\r");
+        if (start != string::npos && position[start] != '#') return true;
+    }
+    return false;
+}
+
+//Returns false with an error as the result if the position can't be analyzed.
+bool BatchAnalyzer::Analyze(const string& position, int line_number, string& result) {
+    istringstream moves(position);
+    int size;
+    if (!(moves >> size) || size < HexConst::MIN_BOARD_SIZE || size > HexConst::MAX_BOARD_SIZE) {
+        result = GetError(line_number, "invalid board size");
+        return false;
+    }
+    Board board(size);
+    const Player* turn = &Player::BLUE_PLAYER; //Blue Player starts
+    string name;
+    while (moves >> name) {
+        int pos = Move::GetPosition(name, size);
+        if (pos < 0 || board.IsOccupied(pos)) {
+            //the move ends where the stream is, or at the end of the line
+            size_t end = moves.eof() ? position.size() : static_cast<size_t>(moves.tellg());
+            result = GetError(line_number, end - name.size() + 1, "invalid move");
+            return false;
+        }
+        board.Occupy(pos, *turn);
+        if (board.HasWon(*turn)) {
+            result = GetError(line_number, "the game is over");
+            return false;
+        }
+        turn = *turn == Player::BLUE_PLAYER ? &Player::RED_PLAYER : &Player::BLUE_PLAYER;
+    }
+    Ai ai(board, turn->PlaysFirst(), pool_, 1);
+    ai.SetTimeBudget(budget_ms_ / 1000.0);
+    auto start = chrono::steady_clock::now();
+    int best = ai.ComputePosition();
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    const vector<double>& values = ai.GetMoveValues();
+    ostringstream out;
+    out << "{\"line\":" << line_number
+            << ",\"size\":" << size
+            << ",\"to_move\":\"" << (turn->PlaysFirst() ? "blue" : "red") << "\"";
+    if (best < 0) {
+        out << ",\"best\":\"resign\",\"win_rate\":0";
+    } else {
+        out << ",\"best\":\"" << Move::GetName(best, size) << "\",\"win_rate\":";
+        if (values[best] < 0) {
+            out << "null"; //chosen without simulations
+        } else {
+            out << values[best];
+        }
+    }
+    out << ",\"ms\":" << static_cast<long long>(ms * 1e3) / 1e3 << ",\"cells\":{";
+    bool first = true;
+    for (int pos = 0; pos < static_cast<int>(values.size()); pos++) {
+        if (values[pos] < 0) continue;
+        out << (first ? "" : ",") << "\"" << Move::GetName(pos, size) << "\":" << values[pos];
+        first = false;
+    }
+    out << "}}";
+    result = out.str();
+    return true;
+}
+
+void BatchAnalyzer::Write(const string& result, bool analyzed) {
+    lock_guard<mutex> lock(out_mutex_);
+    if (!analyzed) {
+        errors_++;
+    }
+    out_ << result << endl;
+}
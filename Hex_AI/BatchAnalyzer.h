@@ -0,0 +1,56 @@
+#ifndef __Hex_AI__BatchAnalyzer__
+#define __Hex_AI__BatchAnalyzer__
+
+#include <iostream>
+#include <mutex>
+#include <string>
+
+#include "ThreadPool.h"
+
+/*
+ * Analyzes a stream of positions offline, for reviewing games and finding blunders.
+ * Every input line is a position: the board size followed by its moves, like
+ * "7 D4 C5 E3", played in turns starting with Blue. Empty lines and lines
+ * starting with '#' are skipped.
+ * The AI searches every position for the side to move with a fixed time budget,
+ * and every result is written as one line of JSON:
+ *   {"line":3,"size":7,"to_move":"red","best":"C4","win_rate":0.61,"ms":1002.5,
+ *    "cells":{"C4":0.61,"D3":0.44,...}}
+ * The cells have the win ratio of the side to move after every move the search tested.
+ * The refuted moves have the win ratio of their best known answer, so they are upper
+ * bounds. Positions that can't be read or are over get {"line":n,"error":"..."}, and
+ * an invalid move also gets the column where it starts.
+ * The positions are searched in parallel, and the results are written in the order
+ * they finish. Only one position per worker is in memory at any time.
+ */
+class BatchAnalyzer {
+public:
+    /*
+     * threads    Threads of the shared pool, also the positions searched at the same time
+     * budget_ms  Time limit of every search
+     */
+    BatchAnalyzer(std::istream& in, std::ostream& out, int threads, int budget_ms);
+    BatchAnalyzer(const BatchAnalyzer&) = delete;
+    BatchAnalyzer& operator=(const BatchAnalyzer&) = delete;
+
+    //Analyzes all the positions and returns how many of them had errors.
+    int Run();
+private:
+    void Work();
+    //Reads the next position, returns false at the end of the input.
+    bool ReadPosition(std::string& position, int& line_number);
+    bool Analyze(const std::string& position, int line_number, std::string& result);
+    void Write(const std::string& result, bool analyzed);
+
+    std::istream& in_;
+    std::ostream& out_;
+    const int threads_;
+    const int budget_ms_;
+    ThreadPool pool_;
+    std::mutex in_mutex_;
+    std::mutex out_mutex_;
+    int lines_read_ = 0;
+    int errors_ = 0;
+};
+
+#endif /* defined(__Hex_AI__BatchAnalyzer__) */
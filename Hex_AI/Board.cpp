@@ -8,9 +8,9 @@
 using namespace std;
 
 Board::Board(int size) :
-        AbstractBoard(size), //4 is the rows (of strings) per hexagon
-        drawing_(1 + 4 * size, std::string()), //2 extra vertices in the graphs for virtual nodes
-        graphs_(2, Graph<int>(size * size + 2)) {
+        BoardCore(size), //4 is the rows (of strings) per hexagon
+        drawing_(1 + 4 * size, std::string()), //2 extra vertices in the sets for virtual nodes
+        groups_(2, DisjointSets(size * size + 2)) {
     InitDrawing();
     MakeVirtualNodes();
 }
@@ -145,12 +145,12 @@ void Board::MakeVirtualNodes() {
     int second_virtual = total_nodes - 2;
     //the board edges to which the virtual nodes connect depend on player number
     for (int i = 0; i < GetSize(); i++) {
-        //Graph 0:
+        //Sets 0:
         //virtual node nodes-2 connects to all last row
         MarkConnected(second_virtual, second_virtual - 1 - i, Player::BLUE_PLAYER);
         //virtual node nodes-1 connects to all row 1
         MarkConnected(first_virtual, i, Player::BLUE_PLAYER);
-        //Graph 1:
+        //Sets 1:
         //virtual node nodes-2 connects to all column A
         MarkConnected(second_virtual, i * GetSize(), Player::RED_PLAYER);
         //virtual node nodes-1 connects to all last column
@@ -170,7 +170,7 @@ std::ostream& operator<<(std::ostream& out, const Board& board) {
 //It also updates the adjacency to neighboring positions
 //if they are occupied by the same player
 //x is the number and y the letter
-// Implements pure virtual function
+// Called by BoardCore::Occupy
 void Board::OccupyImpl(int pos, const Player& player) {
     assert(pos >= 0);
     SetStone(pos, player);
@@ -7,7 +7,7 @@
 #include <vector>
 
 #include "AbstractBoard.h"
-#include "Graph.h"
+#include "DisjointSets.h"
 
 /* This class represents a Hex board and can display it on screen.
  * It saves the appearance of the board in a vector of strings.
@@ -26,26 +26,26 @@
  *             \      /
  *             3\____/A
  *
- * The class also has a graph for each player, each with a node for every position
+ * The class also has disjoint sets for each player, with a node for every position
  * in the board, plus 2 virtual nodes that represent the edges that the
- * players have to connect. This way it can be more quickly calculated if
- * a player has won.
+ * players have to connect. A player has won when the two virtual nodes are joined.
  */
-class Board: public AbstractBoard {
+class Board: public BoardCore<Board> {
 public:
     //size  The number of positions per board side.
     explicit Board(int size);
 private:
-    void OccupyImpl(int pos, const Player&) override;
-    void MarkConnected(int pos1, int pos2, const Player& player) override {
+    friend class BoardCore<Board>;
+    void OccupyImpl(int pos, const Player&);
+    void MarkConnected(int pos1, int pos2, const Player& player) {
         assert(pos1 >= 0 && pos2 >= 0);
-        graphs_[GetGraphIndex(player)].AddEdge(pos1, pos2);
+        groups_[GetGroupsIndex(player)].Join(pos1, pos2);
     }
-    bool AreConnected(int pos1, int pos2, const Player& player) const override {
+    bool AreConnected(int pos1, int pos2, const Player& player) const {
         assert(pos1 >= 0 && pos2 >= 0);
-        return graphs_[GetGraphIndex(player)].AreAdjacent(pos1, pos2);
+        return groups_[GetGroupsIndex(player)].AreJoined(pos1, pos2);
     }
-    int GetGraphIndex(const Player& player) const {
+    int GetGroupsIndex(const Player& player) const {
         return player == Player::BLUE_PLAYER ? 0 : 1;
     }
     void MarkBoard(int x, int y, const Player&); //place a mark for a player on the board
@@ -58,6 +58,6 @@ private:
     friend std::ostream& operator<<(std::ostream& stream, const Board& RealBoard);
 
     std::vector<std::string> drawing_; //appearance of the board
-    std::vector<Graph<int>> graphs_;
+    std::vector<DisjointSets> groups_;
 };
 #endif /* defined(__Hex_AI__RealBoard__) */
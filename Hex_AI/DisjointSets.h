@@ -0,0 +1,48 @@
+#ifndef __Hex_AI__DisjointSets__
+#define __Hex_AI__DisjointSets__
+
+#include <utility>
+#include <vector>
+
+/*
+ * Disjoint sets (union-find) of vertices.
+ * The boards use them to know which positions are connected by a player,
+ * so memory grows linearly with the positions instead of
+ * the square of them of an adjacency matrix.
+ */
+class DisjointSets {
+public:
+    explicit DisjointSets(int size) :
+            parents_(size), sizes_(size, 1) {
+        for (int i = 0; i < size; i++) {
+            parents_[i] = i;
+        }
+    }
+
+    //Returns the vertex that represents the set of the given one.
+    //The sets are joined by size, so the trees are at most log2(size) deep.
+    int Find(int x) const {
+        while (parents_[x] != x) {
+            x = parents_[x];
+        }
+        return x;
+    }
+    //Joins the sets of the two vertices.
+    void Join(int x, int y) {
+        x = Find(x);
+        y = Find(y);
+        if (x == y) return;
+        if (sizes_[x] < sizes_[y]) std::swap(x, y);
+        parents_[y] = x;
+        sizes_[x] += sizes_[y];
+    }
+    //Returns true if the two vertices are in the same set.
+    bool AreJoined(int x, int y) const {
+        return Find(x) == Find(y);
+    }
+private:
+    std::vector<int> parents_;
+    std::vector<int> sizes_;
+};
+
+#endif /* defined(__Hex_AI__DisjointSets__) */
@@ -0,0 +1,353 @@
+#include "EngineDaemon.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Ai.h"
+#include "Board.h"
+#include "GameRecord.h"
+#include "HexConst.h"
+#include "Move.h"
+#include "Player.h"
+#include "SearchHandle.h"
+
+using namespace std;
+
+/*
+ * A game hosted by the daemon. Its commands run one at a time.
+ */
+struct Session {
+    Session(int size, bool computer_first, ThreadPool& pool, int threads, int budget_ms, bool clock) :
+            board(size),
+            ai(board, computer_first, pool, threads),
+            computer(computer_first ? Player::BLUE_PLAYER : Player::RED_PLAYER),
+            budget_ms(budget_ms),
+            clock(clock) {
+        if (clock) {
+            ai.SetGameClock(budget_ms / 1000.0);
+        }
+    }
+
+    void Record(int pos, const Player& player, double think_seconds = 0, long long playouts = 0) {
+        if (!recorder) return;
+        GameRecord::MoveRecord move;
+        move.position = pos;
+        move.player_id = player.GetId();
+        move.think_seconds = think_seconds;
+        move.playouts = playouts;
+        recorder->AddMove(move);
+    }
+
+    std::mutex commands_mutex;
+    Board board;
+    Ai ai;
+    const Player& computer;
+    const Player* turn = &Player::BLUE_PLAYER; //Blue Player starts
+    const Player* winner = nullptr;
+    const int budget_ms;
+    const bool clock; //the budget is for the whole game
+    std::unique_ptr<GameRecorder> recorder;
+};
+
+namespace {
+
+    const Player& GetOther(const Player& player) {
+        return player == Player::BLUE_PLAYER ? Player::RED_PLAYER : Player::BLUE_PLAYER;
+    }
+
+    //Returns the first word of the player's name in lower case.
+    string GetColor(const Player& player) {
+        return player.PlaysFirst() ? "blue" : "red";
+    }
+}
+
+void SearchScheduler::Acquire() {
+    unique_lock<mutex> lock(mutex_);
+    long long ticket = next_ticket_++;
+    condition_.wait(lock, [this, ticket] { return ticket < released_ + slots_; });
+}
+
+void SearchScheduler::Release() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        released_++;
+    }
+    condition_.notify_all();
+}
+
+EngineDaemon::EngineDaemon(const string& socket_path, int threads, const string& record_dir) :
+        socket_path_(socket_path),
+        threads_(threads),
+        record_dir_(record_dir),
+        pool_(threads),
+        scheduler_(threads),
+        stopping_(false) {
+}
+
+EngineDaemon::~EngineDaemon() {
+    Stop();
+    for (auto& it : client_threads_) {
+        it.second.join();
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        unlink(socket_path_.c_str());
+    }
+}
+
+void EngineDaemon::Run() {
+    //a client that leaves while it gets an answer must not end the daemon
+    signal(SIGPIPE, SIG_IGN);
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path_.size() >= sizeof(address.sun_path)) {
+        throw runtime_error("socket path too long: " + socket_path_);
+    }
+    strcpy(address.sun_path, socket_path_.c_str());
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path_.c_str());
+    if (listen_fd_ < 0 || ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+            || listen(listen_fd_, SOMAXCONN) != 0) {
+        throw runtime_error("can't listen on " + socket_path_ + ": " + strerror(errno));
+    }
+    while (!stopping_) {
+        int client = accept(listen_fd_, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            break; //the socket was shut down
+        }
+        lock_guard<mutex> lock(clients_mutex_);
+        //a finished thread only has to return, it doesn't need the lock anymore
+        for (thread::id id : finished_clients_) {
+            client_threads_[id].join();
+            client_threads_.erase(id);
+        }
+        finished_clients_.clear();
+        //Stop sets the flag before it takes the lock, so a client that comes after it
+        //would never be shut down
+        if (stopping_) {
+            close(client);
+            break;
+        }
+        client_fds_.insert(client);
+        thread client_thread(&EngineDaemon::Serve, this, client);
+        client_threads_[client_thread.get_id()] = move(client_thread);
+    }
+}
+
+//Reads the commands of a client line by line and answers each one.
+void EngineDaemon::Serve(int client) {
+    string pending;
+    char buffer[4096];
+    bool open = true;
+    while (open) {
+        ssize_t read_bytes = read(client, buffer, sizeof(buffer));
+        if (read_bytes <= 0) break;
+        pending.append(buffer, read_bytes);
+        size_t end;
+        while (open && (end = pending.find('\n')) != string::npos) {
+            string command = pending.substr(0, end);
+            pending.erase(0, end + 1);
+            if (!command.empty() && command.back() == '\r') command.pop_back();
+            string answer = Execute(command) + "\n";
+            open = send(client, answer.data(), answer.size(), 0) == static_cast<ssize_t>(answer.size())
+                    && !stopping_;
+        }
+    }
+    lock_guard<mutex> lock(clients_mutex_);
+    client_fds_.erase(client);
+    close(client);
+    finished_clients_.push_back(this_thread::get_id());
+}
+
+string EngineDaemon::Execute(const string& command) {
+    istringstream args(command);
+    string name;
+    args >> name;
+    if (name == "new") {
+        return NewGame(args);
+    }
+    if (name == "shutdown") {
+        Stop();
+        return "ok";
+    }
+    int id;
+    if (!(args >> id)) {
+        return name.empty() ? "error empty command" : "error unknown command or missing game";
+    }
+    if (name == "close") {
+        lock_guard<mutex> lock(sessions_mutex_);
+        return sessions_.erase(id) > 0 ? "ok" : "error no game " + to_string(id);
+    }
+    shared_ptr<Session> session = FindSession(id);
+    if (!session) {
+        return "error no game " + to_string(id);
+    }
+    lock_guard<mutex> lock(session->commands_mutex);
+    if (name == "play") {
+        return Play(*session, args);
+    } else if (name == "genmove") {
+        return GenerateMove(*session);
+    } else if (name == "status") {
+        return session->winner == nullptr ? "ok playing" : "ok " + GetColor(*session->winner) + " won";
+    }
+    return "error unknown command " + name;
+}
+
+shared_ptr<Session> EngineDaemon::FindSession(int id) {
+    lock_guard<mutex> lock(sessions_mutex_);
+    auto it = sessions_.find(id);
+    return it == sessions_.end() ? nullptr : it->second;
+}
+
+string EngineDaemon::NewGame(istream& args) {
+    int size;
+    string first;
+    if (!(args >> size >> first) || size < HexConst::MIN_BOARD_SIZE || size > HexConst::MAX_BOARD_SIZE
+            || (toupper(first[0]) != 'C' && toupper(first[0]) != 'H')) {
+        return "error use: new <size " + to_string(HexConst::MIN_BOARD_SIZE) + " to "
+                + to_string(HexConst::MAX_BOARD_SIZE) + "> <computer|human> [budget ms] [clock]";
+    }
+    int budget_ms = DEFAULT_BUDGET_MS;
+    if (!(args >> budget_ms)) {
+        budget_ms = DEFAULT_BUDGET_MS;
+    } else if (budget_ms <= 0) {
+        return "error the budget must be positive";
+    }
+    string clock;
+    args >> clock;
+    if (!clock.empty() && clock != "clock") {
+        return "error unknown budget " + clock;
+    }
+    bool computer_first = toupper(first[0]) == 'C';
+    auto session = make_shared<Session>(size, computer_first, pool_, threads_, budget_ms, !clock.empty());
+    if (persistent_cache_) {
+        session->ai.SetPersistentCache(persistent_cache_);
+    }
+    int id;
+    {
+        lock_guard<mutex> lock(sessions_mutex_);
+        id = next_id_++;
+        sessions_[id] = session;
+    }
+    StartRecord(*session, id);
+    return "ok " + to_string(id);
+}
+
+//A game that can't be recorded is still played.
+void EngineDaemon::StartRecord(Session& session, int id) {
+    if (record_dir_.empty()) return;
+    GameRecord settings;
+    settings.board_size = session.board.GetSize();
+    settings.computer = session.computer.PlaysFirst() ? GameRecord::COMPUTER_BLUE : GameRecord::COMPUTER_RED;
+    settings.threads = threads_;
+    settings.SetAiSettings(session.ai);
+    settings.budget_ms = session.budget_ms;
+    string path = record_dir_ + "/game-" + to_string(getpid()) + "-" + to_string(id) + ".hexr";
+    lock_guard<mutex> lock(session.commands_mutex);
+    try {
+        session.recorder.reset(new GameRecorder(path, settings));
+    } catch (const runtime_error& e) {
+        cerr << e.what() << endl;
+    }
+}
+
+string EngineDaemon::Play(Session& session, istream& args) {
+    string name;
+    args >> name;
+    if (session.winner != nullptr) return "error the game is over";
+    if (*session.turn == session.computer) return "error it is the computer's turn";
+    int pos = Move::GetPosition(name, session.board.GetSize());
+    if (pos < 0 || session.board.IsOccupied(pos)) return "error invalid move " + name;
+    session.board.Occupy(pos, *session.turn);
+    session.Record(pos, *session.turn);
+    if (session.board.HasWon(*session.turn)) {
+        session.winner = session.turn;
+    }
+    session.turn = &GetOther(*session.turn);
+    return "ok";
+}
+
+//Waits for its turn to search, and the wait counts as part of the budget.
+string EngineDaemon::GenerateMove(Session& session) {
+    if (session.winner != nullptr) return "error the game is over";
+    if (!(*session.turn == session.computer)) return "error it is the human's turn";
+    auto start = chrono::steady_clock::now();
+    scheduler_.Acquire();
+    double waited = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (session.clock) {
+        //the wait is taken from the time of the game
+        session.ai.SetGameClock(max(0.0, session.ai.GetClockLeft() - waited));
+    } else {
+        //a search always gets a tenth of the budget
+        double budget = session.budget_ms / 1000.0;
+        session.ai.SetTimeBudget(max(budget - waited, budget / 10));
+    }
+    int pos;
+    auto search_start = chrono::steady_clock::now();
+    try {
+        pos = RunSearch(session.ai);
+    } catch (...) {
+        scheduler_.Release();
+        throw;
+    }
+    scheduler_.Release();
+    double searched = chrono::duration<double>(chrono::steady_clock::now() - search_start).count();
+    session.Record(pos, session.computer, searched, session.ai.GetLastStats().playouts);
+    if (pos < 0) {
+        session.winner = &GetOther(session.computer);
+        return "ok resign";
+    }
+    session.board.Occupy(pos, session.computer);
+    if (session.board.HasWon(session.computer)) {
+        session.winner = &session.computer;
+    }
+    session.turn = &GetOther(*session.turn);
+    return "ok " + Move::GetName(pos, session.board.GetSize());
+}
+
+//Searches in the background, so that a shutdown can stop the search.
+int EngineDaemon::RunSearch(Ai& ai) {
+    unique_ptr<SearchHandle> search = ai.StartSearch();
+    struct Registration {
+        EngineDaemon& daemon;
+        SearchHandle& search;
+        ~Registration() {
+            lock_guard<mutex> lock(daemon.searches_mutex_);
+            daemon.searches_.erase(&search);
+        }
+    };
+    {
+        lock_guard<mutex> lock(searches_mutex_);
+        searches_.insert(search.get());
+        if (stopping_) search->Stop();
+    }
+    Registration registration { *this, *search };
+    return search->Wait();
+}
+
+//Wakes up the accept loop and the clients, and stops the searches, so that they finish.
+void EngineDaemon::Stop() {
+    stopping_ = true;
+    {
+        lock_guard<mutex> lock(searches_mutex_);
+        for (SearchHandle* search : searches_) {
+            search->Stop();
+        }
+    }
+    if (listen_fd_ >= 0) {
+        shutdown(listen_fd_, SHUT_RDWR);
+    }
+    lock_guard<mutex> lock(clients_mutex_);
+    for (int fd : client_fds_) {
+        shutdown(fd, SHUT_RD);
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef __Hex_AI__EngineDaemon__
+#define __Hex_AI__EngineDaemon__
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.h"
+
+class Ai;
+class PersistentCache;
+class SearchHandle;
+struct Session;
+
+/*
+ * Lets searches take turns fairly: at most a number of them run at the same time,
+ * and the rest wait in the order they arrived.
+ */
+class SearchScheduler {
+public:
+    explicit SearchScheduler(int slots) :
+            slots_(slots) {
+    }
+    //Waits until the search can run.
+    void Acquire();
+    //Lets the next waiting search run.
+    void Release();
+private:
+    const long long slots_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    long long next_ticket_ = 0;
+    long long released_ = 0;
+};
+
+/*
+ * A long running engine that hosts many games at the same time. All their AIs share
+ * one pool of threads, so the machine is never oversubscribed.
+ * Clients connect to a Unix domain socket and send one command per line,
+ * and every command gets one line back, starting with "ok" or "error":
+ *   new <size> <computer|human> [budget ms] [clock]
+ *                                             starts a game, the second word says who moves
+ *                                             first, answers "ok <game>". With "clock" the
+ *                                             budget is the time of the whole game
+ *                                             instead, see Ai::SetGameClock
+ *   play <game> <move>                        plays the human's move, like "C3"
+ *   genmove <game>                            answers "ok <move>" or "ok resign"
+ *   status <game>                             answers "ok playing", "ok blue won" or "ok red won"
+ *   close <game>                              ends the game
+ *   shutdown                                  stops the daemon
+ * The budget limits the time of every AI move, or of the whole game, counting the time spent
+ * waiting for its turn.
+ * A shutdown stops the running searches, which answer with the best move found.
+ * With a record directory every game is recorded in it as game-<process>-<game>.hexr,
+ * see GameRecord.
+ */
+class EngineDaemon {
+public:
+    static const int DEFAULT_BUDGET_MS = 5000;
+
+    /*
+     * socket_path  Where the socket is created, replacing any file there
+     * threads      Threads of the shared pool, also the searches that run at the same time
+     * record_dir   Where the games are recorded, empty to not record them
+     */
+    EngineDaemon(const std::string& socket_path, int threads, const std::string& record_dir = "");
+    ~EngineDaemon();
+    EngineDaemon(const EngineDaemon&) = delete;
+    EngineDaemon& operator=(const EngineDaemon&) = delete;
+
+    //The AIs of the new games keep their results in the cache, see Ai::SetPersistentCache.
+    void SetPersistentCache(std::shared_ptr<PersistentCache> cache) {
+        persistent_cache_ = std::move(cache);
+    }
+    //Accepts clients until a shutdown command arrives.
+    //Throws std::runtime_error if the socket can't be created.
+    void Run();
+    //Runs a command and returns the answer, without the end of line.
+    std::string Execute(const std::string& command);
+private:
+    void Serve(int client);
+    std::shared_ptr<Session> FindSession(int id);
+    std::string NewGame(std::istream& args);
+    std::string Play(Session& session, std::istream& args);
+    std::string GenerateMove(Session& session);
+    int RunSearch(Ai& ai);
+    void Stop();
+    void StartRecord(Session& session, int id);
+
+    const std::string socket_path_;
+    const int threads_;
+    const std::string record_dir_;
+    ThreadPool pool_;
+    SearchScheduler scheduler_;
+    std::shared_ptr<PersistentCache> persistent_cache_;
+    std::mutex sessions_mutex_;
+    std::map<int, std::shared_ptr<Session>> sessions_;
+    int next_id_ = 1;
+    std::atomic<bool> stopping_;
+    int listen_fd_ = -1;
+    std::mutex clients_mutex_;
+    std::set<int> client_fds_;
+    std::map<std::thread::id, std::thread> client_threads_;
+    //the clients that left, their threads are joined when the next one arrives
+    std::vector<std::thread::id> finished_clients_;
+    std::mutex searches_mutex_;
+    std::set<SearchHandle*> searches_;
+};
+
+#endif /* defined(__Hex_AI__EngineDaemon__) */
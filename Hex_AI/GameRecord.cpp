@@ -0,0 +1,132 @@
+#include "GameRecord.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Ai.h"
+#include "MappedFile.h"
+
+using namespace std;
+
+namespace {
+
+    const char RECORD_MAGIC[4] = { 'H', 'E', 'X', 'R' };
+    const uint32_t RECORD_VERSION = 1;
+
+    struct RecordHeader {
+        char magic[4];
+        uint32_t version;
+        uint8_t board_size;
+        uint8_t computer;
+        uint8_t threads;
+        uint8_t search_mode;
+        uint8_t processes;
+        uint8_t threads_per_process;
+        uint8_t flags;
+        uint8_t reserved;
+        uint64_t seed;
+        uint32_t budget_ms;
+        uint32_t network_checksum;
+    };
+
+    const uint8_t FLAG_PERSISTENT_CACHE = 1;
+    const uint8_t FLAG_GAME_CLOCK = 2;
+    static_assert(sizeof(RecordHeader) == 32, "the header has no padding");
+
+    struct RecordMove {
+        int16_t position;
+        uint8_t player_id;
+        uint8_t reserved;
+        uint32_t think_us;
+        uint32_t playouts;
+    };
+    static_assert(sizeof(RecordMove) == 12, "the moves have no padding");
+}
+
+void GameRecord::SetAiSettings(const Ai& ai) {
+    seed = ai.GetSeed();
+    search_mode = ai.GetSearchMode() == SearchMode::SHARED_TREE ? 1 : 0;
+    processes = ai.GetProcesses();
+    threads_per_process = ai.GetThreadsPerProcess();
+    persistent_cache = ai.HasPersistentCache();
+    network_checksum = ai.GetNetworkChecksum();
+    if (ai.HasGameClock()) {
+        game_clock = true;
+        budget_ms = static_cast<int>(ai.GetClockLeft() * 1000);
+    }
+}
+
+GameRecord GameRecord::Read(const string& path) {
+    MappedFile file(path);
+    RecordHeader header;
+    if (file.GetSize() < sizeof(header)) {
+        throw runtime_error(path + " is not a game record");
+    }
+    memcpy(&header, file.GetData(), sizeof(header));
+    if (memcmp(header.magic, RECORD_MAGIC, sizeof(header.magic)) != 0
+            || header.version != RECORD_VERSION) {
+        throw runtime_error(path + " is not a game record of this version");
+    }
+    GameRecord record;
+    record.board_size = header.board_size;
+    record.computer = header.computer;
+    record.threads = header.threads;
+    record.seed = header.seed;
+    record.budget_ms = header.budget_ms;
+    record.search_mode = header.search_mode;
+    record.processes = max(1, static_cast<int>(header.processes));
+    record.threads_per_process = max(1, static_cast<int>(header.threads_per_process));
+    record.persistent_cache = (header.flags & FLAG_PERSISTENT_CACHE) != 0;
+    record.game_clock = (header.flags & FLAG_GAME_CLOCK) != 0;
+    record.network_checksum = header.network_checksum;
+    //a move cut by a crash is ignored
+    size_t count = (file.GetSize() - sizeof(header)) / sizeof(RecordMove);
+    const char* data = file.GetData() + sizeof(header);
+    for (size_t i = 0; i < count; i++, data += sizeof(RecordMove)) {
+        RecordMove stored;
+        memcpy(&stored, data, sizeof(stored));
+        MoveRecord move;
+        move.position = stored.position;
+        move.player_id = stored.player_id;
+        move.think_seconds = stored.think_us / 1e6;
+        move.playouts = stored.playouts;
+        record.moves.push_back(move);
+    }
+    return record;
+}
+
+GameRecorder::GameRecorder(const string& path, const GameRecord& settings) :
+        out_(path, ios::binary | ios::trunc) {
+    if (!out_) {
+        throw runtime_error("can't write the game record " + path);
+    }
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+    header.version = RECORD_VERSION;
+    header.board_size = static_cast<uint8_t>(settings.board_size);
+    header.computer = static_cast<uint8_t>(settings.computer);
+    header.threads = static_cast<uint8_t>(settings.threads);
+    header.seed = settings.seed;
+    header.budget_ms = static_cast<uint32_t>(settings.budget_ms);
+    header.search_mode = static_cast<uint8_t>(settings.search_mode);
+    header.processes = static_cast<uint8_t>(settings.processes);
+    header.threads_per_process = static_cast<uint8_t>(settings.threads_per_process);
+    header.flags = (settings.persistent_cache ? FLAG_PERSISTENT_CACHE : 0)
+            | (settings.game_clock ? FLAG_GAME_CLOCK : 0);
+    header.network_checksum = settings.network_checksum;
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.flush();
+}
+
+void GameRecorder::AddMove(const GameRecord::MoveRecord& move) {
+    RecordMove stored;
+    memset(&stored, 0, sizeof(stored));
+    stored.position = static_cast<int16_t>(move.position);
+    stored.player_id = static_cast<uint8_t>(move.player_id);
+    stored.think_us = static_cast<uint32_t>(move.think_seconds * 1e6);
+    stored.playouts = static_cast<uint32_t>(move.playouts);
+    out_.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+    out_.flush();
+}
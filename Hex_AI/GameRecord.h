@@ -0,0 +1,78 @@
+#ifndef __Hex_AI__GameRecord__
+#define __Hex_AI__GameRecord__
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class Ai;
+
+/*
+ * A game as it was played, with what the engine needed to play it again.
+ * The file has a header of 32 bytes:
+ *   "HEXR", version, board size, computer color, threads, search mode, processes,
+ *   threads per process, flags, 0, seed, budget ms, network checksum
+ * followed by a record of 12 bytes per move:
+ *   position (-1 if the player gave up), player id, 0, think time (us), playouts
+ * The flags have bit 0 set if the AI used a persistent cache, and bit 1 if the budget is
+ * the clock of the whole game. The engine settings after the threads were zeros in the
+ * first records, which are the defaults.
+ * Numbers are little endian like the machines that run the engine. The header has no
+ * move count, so the moves are written as they are played and a game cut short by
+ * a crash is still readable.
+ */
+struct GameRecord {
+    //color of the computer
+    static const int NO_COMPUTER = 0;
+    static const int COMPUTER_BLUE = 1;
+    static const int COMPUTER_RED = 2;
+
+    struct MoveRecord {
+        int position = -1;
+        int player_id = 0;
+        //zero for the human moves
+        double think_seconds = 0;
+        long long playouts = 0;
+    };
+
+    int board_size = 0;
+    int computer = NO_COMPUTER;
+    int threads = 0;
+    uint64_t seed = 0;
+    //time limit of every AI move, 0 without limit
+    int budget_ms = 0;
+    //the budget is the time of the whole game instead, see Ai::SetGameClock
+    bool game_clock = false;
+    //the other settings of the AI that change its moves, see Ai
+    int search_mode = 0; //0 for PRUNING and 1 for SHARED_TREE
+    int processes = 1;
+    int threads_per_process = 1;
+    bool persistent_cache = false;
+    uint32_t network_checksum = 0; //0 without a network
+    std::vector<MoveRecord> moves;
+
+    //Copies the seed and the settings of the AI that change its moves, and the clock if it
+    //plays under one.
+    void SetAiSettings(const Ai& ai);
+    //Reads a whole record. Throws std::runtime_error if it isn't a record of this version.
+    static GameRecord Read(const std::string& path);
+};
+
+/*
+ * Writes a game record while the game is played, every move reaches the file at once.
+ * Throws std::runtime_error if the file can't be created.
+ */
+class GameRecorder {
+public:
+    //Writes the header with the settings of the record, its moves are ignored.
+    GameRecorder(const std::string& path, const GameRecord& settings);
+    GameRecorder(const GameRecorder&) = delete;
+    GameRecorder& operator=(const GameRecorder&) = delete;
+
+    void AddMove(const GameRecord::MoveRecord& move);
+private:
+    std::ofstream out_;
+};
+
+#endif /* defined(__Hex_AI__GameRecord__) */
@@ -0,0 +1,100 @@
+#include "GameReplay.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+#include "Ai.h"
+#include "Board.h"
+#include "HexConst.h"
+#include "Move.h"
+#include "NeuralBatcher.h"
+#include "Player.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+namespace {
+
+    double GetMilliseconds(double seconds) {
+        return static_cast<long long>(seconds * 1e6) / 1e3; //rounded to microseconds
+    }
+
+    string GetMoveName(int pos, int board_size) {
+        return pos < 0 ? "resign" : Move::GetName(pos, board_size);
+    }
+}
+
+int GameReplay::Run() {
+    const int size = record_.board_size;
+    if (size < HexConst::MIN_BOARD_SIZE || size > HexConst::MAX_BOARD_SIZE) {
+        throw runtime_error("invalid board size " + to_string(size));
+    }
+    const bool computer_first = record_.computer == GameRecord::COMPUTER_BLUE;
+    const Player& computer = computer_first ? Player::BLUE_PLAYER : Player::RED_PLAYER;
+    const int threads = record_.threads > 0 ? record_.threads : Ai::MAX_THREADS;
+    Board board(size);
+    ThreadPool pool(threads);
+    Ai ai(board, computer_first, pool, threads);
+    ai.SetSeed(record_.seed);
+    if (record_.game_clock) {
+        ai.SetGameClock(record_.budget_ms / 1000.0);
+    } else {
+        ai.SetTimeBudget(record_.budget_ms / 1000.0);
+    }
+    if (record_.persistent_cache) {
+        throw runtime_error("the game used a persistent cache, its moves can't be reproduced");
+    }
+    if (record_.network_checksum != 0) {
+        if (!network_ || network_->GetNetwork().GetChecksum() != record_.network_checksum) {
+            throw runtime_error("the game used a network, HEX_NETWORK must name the same one");
+        }
+        ai.SetNetwork(network_);
+    }
+    const SearchMode mode = record_.search_mode == 1 ? SearchMode::SHARED_TREE : SearchMode::PRUNING;
+    ai.SetSearchMode(mode);
+    ai.SetProcesses(record_.processes, record_.threads_per_process);
+    //the threads of a shared tree race for it, and every process searches one
+    const bool reproducible = record_.budget_ms == 0
+            && (record_.processes > 1 ? record_.threads_per_process == 1
+                    : mode == SearchMode::PRUNING || threads == 1);
+
+    int moves = 0;
+    int diverged = 0;
+    double recorded_seconds = 0;
+    double replayed_seconds = 0;
+    for (size_t i = 0; i < record_.moves.size(); i++) {
+        const GameRecord::MoveRecord& move = record_.moves[i];
+        const Player& player = move.player_id == Player::BLUE_PLAYER.GetId() ? Player::BLUE_PLAYER
+                : Player::RED_PLAYER;
+        if (record_.computer != GameRecord::NO_COMPUTER && player == computer) {
+            auto start = chrono::steady_clock::now();
+            int pos = ai.ComputePosition();
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            moves++;
+            diverged += pos == move.position ? 0 : 1;
+            recorded_seconds += move.think_seconds;
+            replayed_seconds += seconds;
+            out_ << "{\"move\":" << i + 1
+                    << ",\"recorded\":\"" << GetMoveName(move.position, size) << "\""
+                    << ",\"replayed\":\"" << GetMoveName(pos, size) << "\""
+                    << ",\"recorded_ms\":" << GetMilliseconds(move.think_seconds)
+                    << ",\"replayed_ms\":" << GetMilliseconds(seconds)
+                    << ",\"recorded_playouts\":" << move.playouts
+                    << ",\"replayed_playouts\":" << ai.GetLastStats().playouts
+                    << "}" << endl;
+        }
+        if (move.position < 0) break; //the player gave up
+        if (move.position >= size * size || board.IsOccupied(move.position)) {
+            throw runtime_error("invalid move " + to_string(move.position) + " at move " + to_string(i + 1));
+        }
+        board.Occupy(move.position, player);
+    }
+    out_ << "{\"moves\":" << moves
+            << ",\"diverged\":" << diverged
+            << ",\"recorded_ms\":" << GetMilliseconds(recorded_seconds)
+            << ",\"replayed_ms\":" << GetMilliseconds(replayed_seconds)
+            << ",\"reproducible\":" << (reproducible ? "true" : "false")
+            << "}" << endl;
+    return diverged;
+}
@@ -0,0 +1,43 @@
+#ifndef __Hex_AI__GameReplay__
+#define __Hex_AI__GameReplay__
+
+#include <iostream>
+#include <memory>
+
+#include "GameRecord.h"
+
+class NeuralBatcher;
+
+/*
+ * Plays a recorded game again, running the engine on every position where the computer
+ * moved with the seed, threads, budget and search settings of the record. Without a budget
+ * the engine chooses the same moves as in the game, unless the engine has changed or the
+ * threads raced for a shared tree, which the totals tell with "reproducible".
+ * A game played with a network needs the same network, and a game played with a
+ * persistent cache can't be replayed, since the cache has changed since then.
+ * Writes a line of JSON for every computer move:
+ *   {"move":5,"recorded":"C4","replayed":"C4","recorded_ms":812.3,"replayed_ms":798.1,
+ *    "recorded_playouts":41200,"replayed_playouts":41200}
+ * and a last line with the totals:
+ *   {"moves":12,"diverged":0,"recorded_ms":9021.4,"replayed_ms":8877.2,
+ *    "reproducible":true}
+ * The game always follows the recorded moves, even after the engine diverges.
+ */
+class GameReplay {
+public:
+    //The network, if any, must be the one that the game used.
+    GameReplay(const GameRecord& record, std::ostream& out, std::shared_ptr<NeuralBatcher> network = nullptr) :
+            record_(record), out_(out), network_(std::move(network)) {
+    }
+
+    //Returns the computer moves that were different from the recorded ones.
+    //Throws std::runtime_error if the record has moves that can't be played, or if
+    //the game can't be played again with its settings.
+    int Run();
+private:
+    const GameRecord& record_;
+    std::ostream& out_;
+    std::shared_ptr<NeuralBatcher> network_;
+};
+
+#endif /* defined(__Hex_AI__GameReplay__) */
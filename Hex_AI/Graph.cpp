@@ -1,72 +1,333 @@
 #include "Graph.h"
 
 #include <random>
-#include <deque>
 #include <iterator>
-#include <stack>
 #include <fstream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <limits>
+
+#include "MappedFile.h"
 
 namespace {
 
-    // Returns a random number between 0 and 1 to represent a probability
-    double RandomProbability() {
-        static std::default_random_engine engine { std::random_device { }() };
-        static std::uniform_real_distribution<double> d { 0.0, 1.0 };
-        return d(engine);
+    const char BINARY_MAGIC[4] = { 'H', 'E', 'X', 'G' };
+    const uint32_t BINARY_VERSION = 1;
+
+    struct BinaryHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t value_type;
+        uint32_t vertices;
+        uint64_t edges;
+    };
+    static_assert(sizeof(BinaryHeader) == 24, "the header has no padding");
+
+    //The size of the edge values plus 256 if they are floating point.
+    template<typename T>
+    uint32_t GetValueType() {
+        return sizeof(T) + (std::is_floating_point<T>::value ? 256 : 0);
+    }
+
+    //Reads the numbers of a text stream in blocks and parses them in place,
+    //so that the file is never kept whole in memory.
+    class NumberReader {
+    public:
+        explicit NumberReader(std::istream& in) :
+                in_(in), buffer_(BLOCK_SIZE + 1), begin_(0), end_(0) {
+            buffer_[0] = '\0';
+        }
+        //Returns false at the end of the stream or if the next word is not a number.
+        template<typename T>
+        bool Next(T& number) {
+            //skip the spaces
+            for (;;) {
+                while (begin_ < end_ && std::isspace(static_cast<unsigned char>(buffer_[begin_]))) {
+                    begin_++;
+                }
+                if (begin_ < end_ || !Fill()) break;
+            }
+            if (begin_ == end_) return false;
+            //the whole word has to be in the buffer
+            size_t word_end = begin_;
+            for (;;) {
+                while (word_end < end_ && !std::isspace(static_cast<unsigned char>(buffer_[word_end]))) {
+                    word_end++;
+                }
+                if (word_end < end_) break;
+                size_t read = word_end - begin_;
+                if (!Fill()) break;
+                word_end = begin_ + read;
+            }
+            char* parsed_end;
+            const char* word = &buffer_[begin_];
+            number = Parse<T>(word, &parsed_end);
+            if (parsed_end == word) return false;
+            begin_ = parsed_end - &buffer_[0];
+            return true;
+        }
+    private:
+        static const size_t BLOCK_SIZE = 1 << 16;
+
+        //Keeps the unread characters at the start of the buffer and reads more after them.
+        //The buffer always ends with '\0', so the parsers stop at its end.
+        bool Fill() {
+            size_t kept = end_ - begin_;
+            std::memmove(&buffer_[0], &buffer_[begin_], kept);
+            begin_ = 0;
+            end_ = kept;
+            if (buffer_.size() - 1 - end_ < BLOCK_SIZE / 2) {
+                buffer_.resize(2 * buffer_.size());
+            }
+            in_.read(&buffer_[end_], buffer_.size() - 1 - end_);
+            size_t read = static_cast<size_t>(in_.gcount());
+            end_ += read;
+            buffer_[end_] = '\0';
+            return read > 0;
+        }
+
+        template<typename T>
+        static typename std::enable_if<std::is_integral<T>::value, T>::type
+        Parse(const char* word, char** word_end) {
+            return static_cast<T>(std::strtoll(word, word_end, 10));
+        }
+        template<typename T>
+        static typename std::enable_if<std::is_floating_point<T>::value, T>::type
+        Parse(const char* word, char** word_end) {
+            return static_cast<T>(std::strtod(word, word_end));
+        }
+
+        std::istream& in_;
+        std::vector<char> buffer_;
+        size_t begin_;
+        size_t end_;
+    };
+
+    //Rows of the random graphs generated with the same stream of numbers.
+    //It doesn't depend on the threads so that the graph doesn't either.
+    const int ROWS_PER_STREAM = 64;
+    //Below this density the generator jumps from edge to edge instead of
+    //drawing a probability for every pair of vertices.
+    const double SPARSE_DENSITY = 0.25;
+
+    typedef std::mt19937_64 RandomEngine;
+
+    //Returns the engine of a block of rows, independent of the other blocks.
+    RandomEngine MakeStream(uint64_t seed, int block) {
+        std::seed_seq sequence { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32),
+                                 static_cast<uint32_t>(block) };
+        return RandomEngine(sequence);
     }
 
     // Returns a random integral number in the given range
     template<typename T>
     typename std::enable_if<std::is_integral<T>::value, T>::type
-    RandomEdgeValue(T range_min, T range_max) {
-        static std::default_random_engine engine { std::random_device { }() };
-        static std::uniform_int_distribution<T> d { range_min, range_max };
+    RandomEdgeValue(T range_min, T range_max, RandomEngine& engine) {
+        std::uniform_int_distribution<T> d { range_min, range_max };
         return d(engine);
     }
 
     // Returns a random floating point number in the given range
     template<typename T>
     typename std::enable_if<std::is_floating_point<T>::value, T>::type
-    RandomEdgeValue(T range_min, T range_max) {
-        static std::default_random_engine engine { std::random_device { }() };
-        static std::uniform_real_distribution<T> d { range_min, range_max };
+    RandomEdgeValue(T range_min, T range_max, RandomEngine& engine) {
+        std::uniform_real_distribution<T> d { range_min, range_max };
         return d(engine);
     }
-}
 
-template<typename T>
-Graph<T>::Graph(int size, double density, T range_min, T range_max) :
-        size_(size), edges_(size, std::vector<T>(size)) {
-    for (int i = 0; i < size_; i++) {
-        for (int j = i; j < size_; j++) {
-            if ((i != j) && RandomProbability() < density) {
-                edges_[i][j] = edges_[j][i] = RandomEdgeValue<T>(range_min, range_max);
+    template<typename T>
+    struct RandomEdge {
+        int x;
+        int y;
+        T value;
+    };
+
+    //Returns the edges from the rows in [first, last) to the vertices after them.
+    //For sparse graphs the distance to the next edge follows a geometric distribution,
+    //so only the edges take random numbers.
+    template<typename T>
+    std::vector<RandomEdge<T>> MakeRandomEdges(int size, int first, int last, double density,
+                                               T range_min, T range_max, RandomEngine& engine) {
+        std::vector<RandomEdge<T>> edges;
+        if (density <= 0) return edges;
+        std::uniform_real_distribution<double> probability(0.0, 1.0);
+        if (density >= SPARSE_DENSITY) {
+            for (int i = first; i < last; i++) {
+                for (int j = i + 1; j < size; j++) {
+                    if (probability(engine) < density) {
+                        edges.push_back(RandomEdge<T> { i, j, RandomEdgeValue<T>(range_min, range_max, engine) });
+                    }
+                }
             }
+            return edges;
         }
+        double log_miss = std::log(1 - density);
+        for (int i = first; i < last; i++) {
+            int j = i;
+            for (;;) {
+                //1 - probability is in (0, 1], so the logarithm is finite
+                double skipped = std::log(1 - probability(engine)) / log_miss;
+                if (skipped >= size - 1 - j) break;
+                j += 1 + static_cast<int>(skipped);
+                edges.push_back(RandomEdge<T> { i, j, RandomEdgeValue<T>(range_min, range_max, engine) });
+            }
+        }
+        return edges;
     }
 }
 
-template<typename T>
-Graph<T>::Graph(std::ifstream& ifp) {
-    std::istream_iterator<T> in(ifp), eof; //in(ifp) is an iterator of numbers in the file
-    std::vector<T> input_numbers(in, eof);
-    size_ = static_cast<int>(input_numbers[0]); //first value contains the size of the graph
-    edges_.assign(size_, std::vector<T>(size_)); //create the adjacency matrix
+template<typename T, typename Storage>
+Graph<T, Storage>::Graph(int size, double density, T range_min, T range_max) :
+        Graph(size, density, range_min, range_max, std::random_device { }(), 1) {
+}
 
+//Every block of rows has its own stream, and the threads take the blocks in turns.
+//The edges are set after all the blocks are done, in the order of the blocks.
+template<typename T, typename Storage>
+Graph<T, Storage>::Graph(int size, double density, T range_min, T range_max,
+                         uint64_t seed, int threads) :
+        size_(size), edges_(size) {
+    int blocks = (size + ROWS_PER_STREAM - 1) / ROWS_PER_STREAM;
+    std::vector<std::vector<RandomEdge<T>>> block_edges(blocks);
+    std::atomic<int> next_block(0);
+    auto work = [&]() {
+        for (int block = next_block++; block < blocks; block = next_block++) {
+            RandomEngine engine = MakeStream(seed, block);
+            int first = block * ROWS_PER_STREAM;
+            int last = std::min(size, first + ROWS_PER_STREAM);
+            block_edges[block] = MakeRandomEdges(size, first, last, density, range_min, range_max, engine);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < std::min(threads, blocks); i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (const auto& edges : block_edges) {
+        for (const RandomEdge<T>& edge : edges) {
+            SetEdge(edge.x, edge.y, edge.value);
+        }
+    }
+}
+
+template<typename T, typename Storage>
+Graph<T, Storage>::Graph(std::ifstream& ifp) :
+        size_(0), edges_(0) {
+    NumberReader reader(ifp);
+    T number;
+    if (!reader.Next(number)) return;
+    //first value contains the size of the graph
+    if (number < 0 || number > std::numeric_limits<int>::max()) {
+        throw std::runtime_error("the graph file has an invalid size");
+    }
+    size_ = static_cast<int>(number);
+    edges_ = typename Storage::template Edges<T>(size_);
     //Iterate through number triples
-    for (int i = 1; i < input_numbers.size() - 2; i += 3) {
-        int vertex1 = static_cast<int>(input_numbers[i]);
-        int vertex2 = static_cast<int>(input_numbers[i + 1]);
-        T value = input_numbers[i + 2];
-        edges_[vertex1][vertex2] = value;
+    T vertex1, vertex2, value;
+    while (reader.Next(vertex1) && reader.Next(vertex2) && reader.Next(value)) {
+        //checked before the cast, a value out of the ints can't be cast
+        if (vertex1 < 0 || vertex1 >= size_ || vertex2 < 0 || vertex2 >= size_) {
+            throw std::runtime_error("the graph file has an edge of a vertex out of the graph");
+        }
+        edges_.Set(static_cast<int>(vertex1), static_cast<int>(vertex2), value);
+    }
+}
+
+template<typename T, typename Storage>
+Graph<T, Storage> Graph<T, Storage>::ReadBinary(const std::string& path) {
+    MappedFile file(path);
+    BinaryHeader header;
+    if (file.GetSize() < sizeof(header)) {
+        throw std::runtime_error(path + " is not a graph file");
+    }
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if (std::memcmp(header.magic, BINARY_MAGIC, sizeof(header.magic)) != 0
+            || header.version != BINARY_VERSION) {
+        throw std::runtime_error(path + " is not a graph file of this version");
+    }
+    if (header.value_type != GetValueType<T>()) {
+        throw std::runtime_error(path + " has a different type of edge values");
+    }
+    if (header.vertices > static_cast<uint32_t>(std::numeric_limits<int>::max())) {
+        throw std::runtime_error(path + " has an invalid size");
+    }
+    const size_t record_size = 2 * sizeof(int32_t) + sizeof(T);
+    if ((file.GetSize() - sizeof(header)) / record_size < header.edges) {
+        throw std::runtime_error(path + " is truncated");
+    }
+    Graph graph(static_cast<int>(header.vertices));
+    const char* record = file.GetData() + sizeof(header);
+    for (uint64_t i = 0; i < header.edges; i++, record += record_size) {
+        int32_t vertex1, vertex2;
+        T value;
+        //the records are not aligned
+        std::memcpy(&vertex1, record, sizeof(vertex1));
+        std::memcpy(&vertex2, record + sizeof(vertex1), sizeof(vertex2));
+        std::memcpy(&value, record + 2 * sizeof(int32_t), sizeof(value));
+        if (vertex1 < 0 || vertex1 >= graph.size_ || vertex2 < 0 || vertex2 >= graph.size_) {
+            throw std::runtime_error(path + " has an edge of a vertex out of the graph");
+        }
+        graph.edges_.Set(vertex1, vertex2, value);
+    }
+    return graph;
+}
+
+template<typename T, typename Storage>
+void Graph<T, Storage>::Write(std::ostream& out) const {
+    out << size_ << '\n';
+    for (int x = 0; x < size_; x++) {
+        edges_.ForEach(x, [&out, x](int y, T value) {
+            out << x << ' ' << y << ' ' << value << '\n';
+        });
     }
 }
 
-template<typename T>
-std::ostream& operator<<(std::ostream& out, const Graph<T>& graph) {
+template<typename T, typename Storage>
+void Graph<T, Storage>::WriteBinary(std::ostream& out) const {
+    BinaryHeader header;
+    std::memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+    header.version = BINARY_VERSION;
+    header.value_type = GetValueType<T>();
+    header.vertices = static_cast<uint32_t>(size_);
+    header.edges = static_cast<uint64_t>(CountEdges());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (int x = 0; x < size_; x++) {
+        edges_.ForEach(x, [&out, x](int y, T value) {
+            int32_t vertex1 = x;
+            int32_t vertex2 = y;
+            out.write(reinterpret_cast<const char*>(&vertex1), sizeof(vertex1));
+            out.write(reinterpret_cast<const char*>(&vertex2), sizeof(vertex2));
+            out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        });
+    }
+}
+
+template<typename T, typename Storage>
+long long Graph<T, Storage>::CountEdges() const {
+    long long edges = 0;
+    for (int x = 0; x < size_; x++) {
+        edges_.ForEach(x, [&edges](int, T) {
+            edges++;
+        });
+    }
+    return edges;
+}
+
+template<typename T, typename Storage>
+std::ostream& operator<<(std::ostream& out, const Graph<T, Storage>& graph) {
     for (int i = 0; i < graph.size_; ++i) {
         for (int j = 0; j < graph.size_; ++j) {
-            out << graph.edges_[i][j] << ", ";
+            out << graph.edges_.Get(i, j) << ", ";
             if (j == graph.size_ - 1) {
                 out << std::endl;
             }
@@ -75,40 +336,91 @@ std::ostream& operator<<(std::ostream& out, const Graph<T>& graph) {
     return out;
 }
 
-template<typename T>
-std::unordered_set<int> Graph<T>::GetNeighbors(int x) const {
+template<typename T, typename Storage>
+std::unordered_set<int> Graph<T, Storage>::GetNeighbors(int x) const {
     std::unordered_set<int> list;
-    for (int i = 0; i < size_; ++i) {
-        if (AreAdjacent(x, i)) {
-            list.insert(i);
-        }
-    }
+    edges_.ForEach(x, [&list](int y, T) {
+        list.insert(y);
+    });
     return list;
 }
 
-template<typename T>
-//Uses Depth-first-search
-std::unordered_set<int> Graph<T>::GetReachable(int start_vertex) const {
+template<typename T, typename Storage>
+std::unordered_set<int> Graph<T, Storage>::GetReachable(int start_vertex) const {
     std::unordered_set<int> reachable;
-    std::deque<bool> visited(size_);
-    std::stack<int> stack;
-    stack.push(start_vertex);
-    visited[start_vertex] = true;
-    while (!stack.empty()) {
-        int current_node = stack.top();
-        stack.pop();
-        //find next accessible not-yet-visited vertices
-        for (int other = size_ - 1; other >= 0; other--) {
-            if (!visited[other] && AreAdjacent(current_node, other)) {
-                stack.push(other);
-                visited[other] = true;
-                reachable.insert(other);
-            }
+    GetReachableVertices(start_vertex).ForEach([&reachable](int x) {
+        reachable.insert(x);
+    });
+    reachable.erase(start_vertex); //the start is not part of the result
+    return reachable;
+}
+
+template<typename T, typename Storage>
+VertexSet Graph<T, Storage>::GetReachableVertices(int start_vertex) const {
+    VertexSet reached(size_);
+    VertexSet frontier(size_);
+    VertexSet next(size_);
+    reached.Set(start_vertex);
+    frontier.Set(start_vertex);
+    while (!frontier.IsEmpty()) {
+        next.Clear();
+        frontier.ForEach([&](int x) {
+            edges_.ForEach(x, [&](int y, T) {
+                if (!reached.Test(y)) {
+                    reached.Set(y);
+                    next.Set(y);
+                }
+            });
+        });
+        std::swap(frontier, next);
+    }
+    return reached;
+}
+
+//Bottom up levels cost about the vertices left instead of the edges of the level,
+//so they pay off when the level has more than 1/BOTTOM_UP_FACTOR of them.
+template<typename T, typename Storage>
+VertexSet Graph<T, Storage>::GetUndirectedReachableVertices(int start_vertex) const {
+    const int BOTTOM_UP_FACTOR = 14;
+    VertexSet reached(size_);
+    VertexSet frontier(size_);
+    VertexSet next(size_);
+    reached.Set(start_vertex);
+    frontier.Set(start_vertex);
+    int frontier_count = 1;
+    int left_count = size_ - 1;
+    while (frontier_count > 0) {
+        next.Clear();
+        if (frontier_count * BOTTOM_UP_FACTOR > left_count) {
+            reached.ForEachMissing([&](int x) {
+                if (edges_.Any(x, [&frontier](int y) { return frontier.Test(y); })) {
+                    next.Set(x);
+                }
+            });
+            reached |= next;
+        } else {
+            frontier.ForEach([&](int x) {
+                edges_.ForEach(x, [&](int y, T) {
+                    if (!reached.Test(y)) {
+                        reached.Set(y);
+                        next.Set(y);
+                    }
+                });
+            });
         }
+        std::swap(frontier, next);
+        frontier_count = frontier.Count();
+        left_count -= frontier_count;
     }
-    return reachable;
+    return reached;
 }
 
-template class Graph<int> ;
+template class Graph<int, DenseStorage> ;
+template class Graph<double, DenseStorage> ;
+template class Graph<int, SparseStorage> ;
+template class Graph<double, SparseStorage> ;
 
-template std::ostream& operator<<(std::ostream& out, const Graph<int>& graph);
+template std::ostream& operator<<(std::ostream& out, const Graph<int, DenseStorage>& graph);
+template std::ostream& operator<<(std::ostream& out, const Graph<double, DenseStorage>& graph);
+template std::ostream& operator<<(std::ostream& out, const Graph<int, SparseStorage>& graph);
+template std::ostream& operator<<(std::ostream& out, const Graph<double, SparseStorage>& graph);
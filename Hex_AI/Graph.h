@@ -1,23 +1,28 @@
 #ifndef __HW_2__Graph__
 #define __HW_2__Graph__
 
+#include <cstdint>
 #include <iostream>
+#include <string>
 #include <unordered_set>
 #include <vector>
 
-template<typename T>
+#include "GraphStorage.h"
+#include "VertexSet.h"
+
+template<typename T, typename Storage>
 class Graph;
 
-template<typename T>
-std::ostream& operator<<(std::ostream& out, const Graph<T>& graph);
+template<typename T, typename Storage>
+std::ostream& operator<<(std::ostream& out, const Graph<T, Storage>& graph);
 
 /*
- * Uses a connectivity matrix to represent the edges of a graph
- * Each element of edges_ contains the distance to another vertex
- * or 0 if there is no edge.
+ * Uses a connectivity matrix or neighbor lists, chosen by the Storage policy,
+ * to represent the edges of a graph. See GraphStorage.h.
+ * Each edge contains the distance to another vertex or 0 if there is no edge.
  * Edges are unidirectional.
  */
-template<typename T>
+template<typename T, typename Storage = DenseStorage>
 class Graph {
     static_assert(std::is_arithmetic<T>::value,
             "template argument must be an arithmetic type");
@@ -26,19 +31,44 @@ public:
      * Builds an empty graph (with no edges).
      */
     explicit Graph(int size) :
-            size_(size), edges_(size, std::vector<T>(size)) {
+            size_(size), edges_(size) {
     }
     /*
      * Builds a graph with an initial amount of edges dependent of
      * the given density with edge values in the given range (inclusive).
      */
     Graph(int size, double density, T range_min, T range_max);
+    /*
+     * Same as above, but the graph only depends on the seed. The rows are split
+     * in blocks with their own random streams, and the given threads generate them,
+     * so the same seed gives the same graph with any amount of threads.
+     */
+    Graph(int size, double density, T range_min, T range_max, uint64_t seed, int threads);
     /*
      * This constructor receives a file and uses it to build the graph.
      * The file format is an initial integer that is the size of the graph
      * and the rest of values are number triples: (vertex 1, vertex 2, edge value).
+     * The file is parsed while it is read, so only the graph is kept in memory.
+     * Throws std::runtime_error if the size is negative or an edge has a vertex
+     * out of the graph.
      */
     Graph(std::ifstream& ifs);
+    /*
+     * Loads a graph written by WriteBinary. The file is mapped into memory
+     * and the edges are read from it directly.
+     * Throws std::runtime_error if the file can't be read, wasn't written
+     * for the same type of edge values or has an edge of a vertex out of the graph.
+     */
+    static Graph ReadBinary(const std::string& path);
+
+    /* Writes the graph in the text format of the file constructor. */
+    void Write(std::ostream& out) const;
+    /*
+     * Writes the graph in binary: a 24 byte header with "HEXG", the format version,
+     * the type of the values, the vertices and the edges, followed by the edges
+     * as (int32 vertex 1, int32 vertex 2, value) in native byte order.
+     */
+    void WriteBinary(std::ostream& out) const;
 
     /* Sets an edge an edge value of 1 between the vertices if the edge doesn't exist already. */
     void AddEdge(int x, int y);
@@ -46,11 +76,23 @@ public:
     void SetEdge(int x, int y, T edge_value);
     //Returns the connected neighbors of the given vertex.
     std::unordered_set<int> GetNeighbors(int x) const;
+    //Calls apply(y, edge value) for every neighbor y of the given vertex.
+    template<typename Apply>
+    void ApplyToNeighbors(int x, Apply apply) const {
+        edges_.ForEach(x, apply);
+    }
     //Returns all the vertices that can be reached by the specified start vertex through any connection.
     std::unordered_set<int> GetReachable(int start_vertex) const;
+    //Returns the start vertex and all the vertices that can be reached from it.
+    //It goes through the graph one level at a time, with the levels kept as sets of bits.
+    VertexSet GetReachableVertices(int start_vertex) const;
+    //Same as GetReachableVertices, but when a level is big compared to the vertices that
+    //are left, it checks which of those have a neighbor in the level instead (bottom up).
+    //The edges must go in both directions, as SetEdge makes them.
+    VertexSet GetUndirectedReachableVertices(int start_vertex) const;
     //Returns true if vertices x and y have an edge.
     bool AreAdjacent(int x, int y) const {
-        return (edges_[x][y] != 0);
+        return (edges_.Get(x, y) != 0);
     }
     //Returns the number of vertices (size of the graph).
     int GetSize() const {
@@ -58,27 +100,30 @@ public:
     }
     //Gets the value of the edge between the two given vertices.
     double GetEdgeValue(int x, int y) const {
-        return edges_[x][y];
+        return edges_.Get(x, y);
     }
+    //Returns the number of edges, each direction counted once.
+    long long CountEdges() const;
 private:
-    friend std::ostream& operator<<<>(std::ostream& out, const Graph<T>& graph);
+    friend std::ostream& operator<<<>(std::ostream& out, const Graph<T, Storage>& graph);
 
     int size_;
-    std::vector<std::vector<T>> edges_; //adjacency matrix with value of the edges
+    typename Storage::template Edges<T> edges_; //value of the edges
 };
 
-template<typename T>
-inline void Graph<T>::AddEdge(int x, int y) {
+template<typename T, typename Storage>
+inline void Graph<T, Storage>::AddEdge(int x, int y) {
     if (!AreAdjacent(x, y)) {
         SetEdge(x, y, 1);
     }
 }
 
-template<typename T>
-inline void Graph<T>::SetEdge(int x, int y, T edge_value) {
+template<typename T, typename Storage>
+inline void Graph<T, Storage>::SetEdge(int x, int y, T edge_value) {
     if (x != y) {
         //no loops
-        edges_[x][y] = edges_[y][x] = edge_value;
+        edges_.Set(x, y, edge_value);
+        edges_.Set(y, x, edge_value);
     }
 }
 
@@ -0,0 +1,166 @@
+#ifndef __Hex_AI__GraphAlgorithms__
+#define __Hex_AI__GraphAlgorithms__
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "DisjointSets.h"
+#include "Graph.h"
+#include "ThreadPool.h"
+
+/*
+ * Weighted graph algorithms on Graph<T, Storage>.
+ * The edge values are the distances and have to be positive, since 0 means no edge.
+ * They are templates over the storage, and they go through the neighbors of every vertex,
+ * so with SparseStorage they take time that grows with the edges.
+ */
+namespace GraphAlgorithms {
+
+    //Distance of the vertices that can't be reached.
+    template<typename T>
+    T Unreachable() {
+        return std::numeric_limits<T>::max();
+    }
+
+    template<typename T>
+    struct Edge {
+        int x;
+        int y;
+        T value;
+    };
+
+    //Returns the distance from the source to every vertex with Dijkstra's algorithm.
+    //A binary heap keeps the closest vertex, and the entries that get a shorter
+    //distance are left in it and skipped when they come out.
+    template<typename T, typename Storage>
+    std::vector<T> GetDistances(const Graph<T, Storage>& graph, int source) {
+        typedef std::pair<T, int> Entry;
+        std::vector<T> distances(graph.GetSize(), Unreachable<T>());
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+        distances[source] = 0;
+        heap.push(Entry(0, source));
+        while (!heap.empty()) {
+            Entry closest = heap.top();
+            heap.pop();
+            int x = closest.second;
+            if (closest.first > distances[x]) continue; //already reached through a shorter path
+            graph.ApplyToNeighbors(x, [&](int y, T value) {
+                T distance = closest.first + value;
+                if (distance < distances[y]) {
+                    distances[y] = distance;
+                    heap.push(Entry(distance, y));
+                }
+            });
+        }
+        return distances;
+    }
+
+    //Returns the distance between every pair of vertices, running Dijkstra from
+    //every source in the pool. Each task takes a block of sources so that
+    //the tasks are few but there are enough to keep every thread busy.
+    template<typename T, typename Storage>
+    std::vector<std::vector<T>> GetAllDistances(const Graph<T, Storage>& graph, ThreadPool& pool) {
+        const int SOURCES_PER_TASK = 16;
+        int size = graph.GetSize();
+        std::vector<std::vector<T>> distances(size);
+        std::vector<std::future<void>> tasks;
+        for (int first = 0; first < size; first += SOURCES_PER_TASK) {
+            int last = std::min(size, first + SOURCES_PER_TASK);
+            tasks.push_back(pool.enqueue([&graph, &distances, first, last]() {
+                for (int source = first; source < last; source++) {
+                    distances[source] = GetDistances(graph, source);
+                }
+            }));
+        }
+        //every task has to finish before leaving, they use local variables
+        for (auto& task : tasks) {
+            task.get();
+        }
+        return distances;
+    }
+
+    //Returns the edges of a minimum spanning forest with Prim's algorithm,
+    //growing a tree from every vertex that isn't in one yet.
+    //The edges are taken as undirected: a vertex joins the tree through the edges that
+    //leave it and the ones that come into it, which are gathered once at the start.
+    template<typename T, typename Storage>
+    std::vector<Edge<T>> GetPrimTree(const Graph<T, Storage>& graph) {
+        //value of the edge, vertex in the tree and vertex out of it
+        typedef std::pair<T, std::pair<int, int>> Entry;
+        int size = graph.GetSize();
+        std::vector<std::vector<std::pair<int, T>>> incoming(size);
+        for (int x = 0; x < size; x++) {
+            graph.ApplyToNeighbors(x, [&](int y, T value) {
+                incoming[y].push_back(std::make_pair(x, value));
+            });
+        }
+        std::vector<bool> in_tree(size, false);
+        std::vector<Edge<T>> tree;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+        auto add_vertex = [&](int x) {
+            in_tree[x] = true;
+            graph.ApplyToNeighbors(x, [&](int y, T value) {
+                if (!in_tree[y]) heap.push(Entry(value, std::make_pair(x, y)));
+            });
+            for (const std::pair<int, T>& edge : incoming[x]) {
+                if (!in_tree[edge.first]) heap.push(Entry(edge.second, std::make_pair(x, edge.first)));
+            }
+        };
+        for (int root = 0; root < size; root++) {
+            if (in_tree[root]) continue;
+            add_vertex(root);
+            while (!heap.empty()) {
+                Entry lightest = heap.top();
+                heap.pop();
+                int y = lightest.second.second;
+                if (in_tree[y]) continue;
+                tree.push_back(Edge<T> { lightest.second.first, y, lightest.first });
+                add_vertex(y);
+            }
+        }
+        return tree;
+    }
+
+    //Returns the edges of a minimum spanning forest with Kruskal's algorithm,
+    //taking the edges from the lightest and skipping the ones that close a cycle.
+    //The edges are taken as undirected.
+    template<typename T, typename Storage>
+    std::vector<Edge<T>> GetKruskalTree(const Graph<T, Storage>& graph) {
+        int size = graph.GetSize();
+        std::vector<Edge<T>> edges;
+        for (int x = 0; x < size; x++) {
+            graph.ApplyToNeighbors(x, [&](int y, T value) {
+                edges.push_back(Edge<T> { x, y, value });
+            });
+        }
+        std::sort(edges.begin(), edges.end(), [](const Edge<T>& a, const Edge<T>& b) {
+            return a.value < b.value;
+        });
+        DisjointSets trees(size);
+        std::vector<Edge<T>> tree;
+        for (const Edge<T>& edge : edges) {
+            if (!trees.AreJoined(edge.x, edge.y)) {
+                trees.Join(edge.x, edge.y);
+                tree.push_back(edge);
+            }
+        }
+        return tree;
+    }
+
+    //Returns the sum of the values of the edges.
+    template<typename T>
+    T GetTotalValue(const std::vector<Edge<T>>& edges) {
+        T total = 0;
+        for (const Edge<T>& edge : edges) {
+            total += edge.value;
+        }
+        return total;
+    }
+}
+
+#endif /* defined(__Hex_AI__GraphAlgorithms__) */
@@ -0,0 +1,103 @@
+#ifndef __Hex_AI__GraphStorage__
+#define __Hex_AI__GraphStorage__
+
+#include <utility>
+#include <vector>
+
+/*
+ * Storage policies for the edges of a Graph.
+ * Each policy has an Edges<T> class with the value of the edge from one
+ * vertex to another, 0 meaning that there is no edge.
+ */
+
+//Adjacency matrix. Finding an edge is constant time, but the memory and
+//the time to go through the neighbors of a vertex grow with the vertices.
+struct DenseStorage {
+    template<typename T>
+    class Edges {
+    public:
+        explicit Edges(int size) :
+                matrix_(size, std::vector<T>(size)) {
+        }
+        T Get(int x, int y) const {
+            return matrix_[x][y];
+        }
+        void Set(int x, int y, T value) {
+            matrix_[x][y] = value;
+        }
+        //Calls apply(y, value) for every edge from x.
+        template<typename Apply>
+        void ForEach(int x, Apply apply) const {
+            const std::vector<T>& row = matrix_[x];
+            for (int y = 0; y < static_cast<int>(row.size()); y++) {
+                if (row[y] != 0) apply(y, row[y]);
+            }
+        }
+        //Returns true if test(y) is true for any edge from x to y.
+        template<typename Test>
+        bool Any(int x, Test test) const {
+            const std::vector<T>& row = matrix_[x];
+            for (int y = 0; y < static_cast<int>(row.size()); y++) {
+                if (row[y] != 0 && test(y)) return true;
+            }
+            return false;
+        }
+    private:
+        std::vector<std::vector<T>> matrix_;
+    };
+};
+
+//A list of neighbors for every vertex. The memory and the time to go through
+//the neighbors grow with the edges, so it suits graphs with a low degree
+//like the hex boards.
+struct SparseStorage {
+    template<typename T>
+    class Edges {
+    public:
+        explicit Edges(int size) :
+                lists_(size) {
+        }
+        T Get(int x, int y) const {
+            for (const auto& it : lists_[x]) {
+                if (it.first == y) return it.second;
+            }
+            return 0;
+        }
+        void Set(int x, int y, T value) {
+            std::vector<std::pair<int, T>>& list = lists_[x];
+            for (auto it = list.begin(); it != list.end(); ++it) {
+                if (it->first == y) {
+                    if (value != 0) {
+                        it->second = value;
+                    } else {
+                        *it = list.back();
+                        list.pop_back();
+                    }
+                    return;
+                }
+            }
+            if (value != 0) {
+                list.push_back(std::make_pair(y, value));
+            }
+        }
+        //Calls apply(y, value) for every edge from x.
+        template<typename Apply>
+        void ForEach(int x, Apply apply) const {
+            for (const auto& it : lists_[x]) {
+                apply(it.first, it.second);
+            }
+        }
+        //Returns true if test(y) is true for any edge from x to y.
+        template<typename Test>
+        bool Any(int x, Test test) const {
+            for (const auto& it : lists_[x]) {
+                if (test(it.first)) return true;
+            }
+            return false;
+        }
+    private:
+        std::vector<std::vector<std::pair<int, T>>> lists_;
+    };
+};
+
+#endif /* defined(__Hex_AI__GraphStorage__) */
@@ -0,0 +1,11 @@
+#ifndef __Hex_AI__HexConst__
+#define __Hex_AI__HexConst__
+
+namespace HexConst {
+    const int MIN_BOARD_SIZE = 5;
+    const int MAX_BOARD_SIZE = 25;
+    //Number of positions of the biggest board.
+    const int MAX_POSITIONS = MAX_BOARD_SIZE * MAX_BOARD_SIZE;
+}
+
+#endif /* defined(__Hex_AI__HexConst__) */
@@ -1,7 +1,10 @@
 #include "HexGame.h"
 
 #include <cassert>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
 #include "Ai.h"
@@ -11,6 +14,7 @@ using namespace std;
 
 void HexGame::RunGame() {
     PrintWelcome();
+    StartRecord();
 
     bool won = false; //has the game finished
     while (!won) {
@@ -25,12 +29,14 @@ void HexGame::RunGame() {
                 cout << "You are good! I give up this time." << endl;
                 //no break
             case MoveResult::USER_GAVE_UP:
+                RecordMove(-1);
                 won = true;
                 move_completed = true;
                 ChangePlayerTurn(); //the other player won
                 break;
             case MoveResult::VALID_MOVE:
                 move_completed = move.Apply(*player_);
+                if (move_completed) RecordMove(move.GetNode());
                 won = board_.HasWon(*player_); //check if the game has been won
                 if (!won) ChangePlayerTurn();
                 break;
@@ -52,6 +58,35 @@ void HexGame::ChangePlayerTurn() {
     }
 }
 
+//A game that can't be recorded is still played.
+void HexGame::StartRecord() {
+    if (record_path_.empty()) return;
+    GameRecord settings;
+    settings.board_size = board_.GetSize();
+    if (is_computer_) {
+        settings.computer = computer_first_ ? GameRecord::COMPUTER_BLUE : GameRecord::COMPUTER_RED;
+        settings.threads = Ai::MAX_THREADS;
+        settings.SetAiSettings(*ai_);
+    }
+    try {
+        recorder_.reset(new GameRecorder(record_path_, settings));
+    } catch (const runtime_error& e) {
+        cerr << e.what() << endl;
+    }
+}
+
+void HexGame::RecordMove(int pos) {
+    if (!recorder_) return;
+    GameRecord::MoveRecord move;
+    move.position = pos;
+    move.player_id = player_->GetId();
+    if (is_computer_ && player_->PlaysFirst() == computer_first_) {
+        move.think_seconds = think_seconds_;
+        move.playouts = playouts_;
+    }
+    recorder_->AddMove(move);
+}
+
 void HexGame::PrintWelcome() {
     if (is_computer_ && computer_first_) {
         cout << endl;
@@ -71,7 +106,18 @@ void HexGame::PrintWelcome() {
 Move HexGame::GetNextMove() {
     if (is_computer_ && player_->PlaysFirst() == computer_first_) {
         //computer's turn
-        return ai_->ComputeMove();
+        cout << "... ";
+        fflush(stdout);
+        auto start = chrono::steady_clock::now();
+        int pos = ai_->ComputePosition();
+        think_seconds_ = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        playouts_ = ai_->GetLastStats().playouts;
+        if (pos < 0) {
+            return Move(Move::AI_GIVE_UP_CODE, board_);
+        }
+        string move = Move::GetName(pos, board_.GetSize());
+        cout << move << endl;
+        return Move(move, board_);
     } else {
         string move_input;
         getline(cin, move_input);
@@ -3,16 +3,14 @@
 
 #include <cassert>
 #include <memory>
+#include <string>
 
 #include "Ai.h"
 #include "Board.h"
+#include "GameRecord.h"
+#include "HexConst.h"
 #include "Player.h"
 
-namespace HexConst {
-    const int MIN_BOARD_SIZE = 5;
-    const int MAX_BOARD_SIZE = 14;
-}
-
 class Move;
 
 /*
@@ -34,11 +32,40 @@ public:
     }
 
     void RunGame();
+    //Writes the AI's search stats of every move to the sink. See Ai::SetStatsSink.
+    void SetStatsSink(std::ostream* sink) {
+        if (ai_) ai_->SetStatsSink(sink);
+    }
+    void SetSearchMode(SearchMode mode) {
+        if (ai_) ai_->SetSearchMode(mode);
+    }
+    //See Ai::SetNetwork.
+    void SetNetwork(std::shared_ptr<NeuralBatcher> network) {
+        if (ai_) ai_->SetNetwork(network);
+    }
+    //See Ai::SetPersistentCache.
+    void SetPersistentCache(std::shared_ptr<PersistentCache> cache) {
+        if (ai_) ai_->SetPersistentCache(cache);
+    }
+    //See Ai::SetProcesses.
+    void SetProcesses(int processes, int threads_per_process) {
+        if (ai_) ai_->SetProcesses(processes, threads_per_process);
+    }
+    //Plays every computer move under a clock for the whole game. See Ai::SetGameClock.
+    void SetGameClock(double seconds) {
+        if (ai_) ai_->SetGameClock(seconds);
+    }
+    //Writes a record of the game to the file while it is played. See GameRecord.
+    void SetRecordPath(const std::string& path) {
+        record_path_ = path;
+    }
 private:
     void PrintWelcome();
     Move GetNextMove();
     void PrintWinner(const Player& winner) const;
     void ChangePlayerTurn();
+    void StartRecord();
+    void RecordMove(int pos);
     HexGame(const HexGame&) = delete;
     HexGame& operator=(const HexGame&) = delete;
 
@@ -48,6 +75,11 @@ private:
     int move_cnt_ = 0;
     const Player* player_ = &Player::BLUE_PLAYER; //Blue Player starts
     std::unique_ptr<Ai> ai_;
+    std::string record_path_;
+    std::unique_ptr<GameRecorder> recorder_;
+    //search of the last computer move
+    double think_seconds_ = 0;
+    long long playouts_ = 0;
 };
 
 #endif /* defined(__Hex_AI__HexGame__) */
@@ -0,0 +1,92 @@
+#ifndef __Hex_AI__HexTopology__
+#define __Hex_AI__HexTopology__
+
+/*
+ * Neighbors of every position of a board of size N, computed at compile time.
+ * Neighbors outside the board are WALL, an extra position after the last one
+ * that is never occupied, so loops over the 6 neighbors need no bounds checks.
+ * The neighbors are in the same order as in ApplyAroundPosition.
+ */
+template<int N>
+class HexTopology {
+public:
+    static const int POSITIONS = N * N;
+    static const int WALL = POSITIONS;
+    static const int DIRECTIONS = 6;
+    //Bits of the edge masks.
+    static const int FIRST_ROW = 1, LAST_ROW = 2, FIRST_COL = 4, LAST_COL = 8;
+
+    struct Cell {
+        int neighbors[DIRECTIONS];
+        int edges; //board edges touched by the position
+    };
+
+    static constexpr Cell MakeCell(int pos) {
+        return Cell { { GetPos(pos / N, pos % N - 1),
+                        GetPos(pos / N, pos % N + 1),
+                        GetPos(pos / N - 1, pos % N),
+                        GetPos(pos / N - 1, pos % N + 1),
+                        GetPos(pos / N + 1, pos % N - 1),
+                        GetPos(pos / N + 1, pos % N) },
+                      (pos / N == 0 ? FIRST_ROW : 0) | (pos / N == N - 1 ? LAST_ROW : 0)
+                      | (pos % N == 0 ? FIRST_COL : 0) | (pos % N == N - 1 ? LAST_COL : 0) };
+    }
+    //Returns the cell of a position, from a table built at compile time.
+    static const Cell& GetCell(int pos);
+private:
+    static constexpr int GetPos(int row, int col) {
+        return row < 0 || row >= N || col < 0 || col >= N ? WALL : row * N + col;
+    }
+};
+
+namespace HexTopologyDetail {
+
+    template<int... Is>
+    struct IndexList {
+    };
+
+    //Builds IndexList<0, 1, ..., Count - 1> with a logarithmic template depth.
+    template<typename First, typename Second>
+    struct JoinIndexes;
+
+    template<int... Is, int... Js>
+    struct JoinIndexes<IndexList<Is...>, IndexList<Js...>> {
+        typedef IndexList<Is..., (sizeof...(Is) + Js)...> type;
+    };
+
+    template<int Count>
+    struct MakeIndexList {
+        typedef typename JoinIndexes<typename MakeIndexList<Count / 2>::type,
+                typename MakeIndexList<Count - Count / 2>::type>::type type;
+    };
+
+    template<>
+    struct MakeIndexList<0> {
+        typedef IndexList<> type;
+    };
+
+    template<>
+    struct MakeIndexList<1> {
+        typedef IndexList<0> type;
+    };
+
+    template<int N, typename Indexes>
+    struct CellTable;
+
+    template<int N, int... Is>
+    struct CellTable<N, IndexList<Is...>> {
+        static constexpr typename HexTopology<N>::Cell CELLS[sizeof...(Is)] = {
+                HexTopology<N>::MakeCell(Is)... };
+    };
+
+    template<int N, int... Is>
+    constexpr typename HexTopology<N>::Cell CellTable<N, IndexList<Is...>>::CELLS[sizeof...(Is)];
+}
+
+template<int N>
+inline const typename HexTopology<N>::Cell& HexTopology<N>::GetCell(int pos) {
+    return HexTopologyDetail::CellTable<N,
+            typename HexTopologyDetail::MakeIndexList<POSITIONS>::type>::CELLS[pos];
+}
+
+#endif /* defined(__Hex_AI__HexTopology__) */
@@ -0,0 +1,90 @@
+#include "InferiorCells.h"
+
+#include "AbstractBoard.h"
+#include "Player.h"
+
+using namespace std;
+
+namespace {
+
+    enum class Owner {
+        FREE, BLUE, RED
+    };
+
+    const int RING_SIZE = 6;
+    //row and column offsets of the surrounding positions, in order around the hexagon
+    const int RING_ROWS[RING_SIZE] = { 0, -1, -1, 0, 1, 1 };
+    const int RING_COLS[RING_SIZE] = { -1, 0, 1, 1, 0, -1 };
+
+    //Returns the owner of a position that can be outside the board.
+    //The first player connects the rows, so the positions above and below
+    //the board are its edges. The ones to the sides belong to the second player.
+    Owner GetOwner(const AbstractBoard& board, int row, int col) {
+        int size = board.GetSize();
+        bool row_out = row < 0 || row >= size;
+        bool col_out = col < 0 || col >= size;
+        if (row_out && col_out) {
+            return Owner::FREE; //corner, any player can use it
+        } else if (row_out) {
+            return Owner::BLUE;
+        } else if (col_out) {
+            return Owner::RED;
+        }
+        int pos = row * size + col;
+        if (board.Belongs(pos, Player::BLUE_PLAYER)) return Owner::BLUE;
+        if (board.Belongs(pos, Player::RED_PLAYER)) return Owner::RED;
+        return Owner::FREE;
+    }
+
+    //Returns true if a stone of the player surrounded by the ring can't help it.
+    bool IsUseless(const Owner (&ring)[RING_SIZE], Owner player) {
+        Owner opponent = player == Owner::BLUE ? Owner::RED : Owner::BLUE;
+        int blocked = -1;
+        for (int i = 0; i < RING_SIZE; i++) {
+            if (ring[i] == opponent) {
+                blocked = i;
+                break;
+            }
+        }
+        if (blocked < 0) {
+            //only useless if every surrounding position is already the player's
+            for (Owner it : ring) {
+                if (it != player) return false;
+            }
+            return true;
+        }
+        int arcs = 0;
+        for (int step = 1; step <= RING_SIZE; step++) {
+            int i = (blocked + step) % RING_SIZE;
+            if (ring[i] == opponent) continue;
+            Owner previous = ring[(i + RING_SIZE - 1) % RING_SIZE];
+            Owner next = ring[(i + 1) % RING_SIZE];
+            if (previous == opponent) {
+                arcs++; //start of an arc
+            } else if (next != opponent && ring[i] != player) {
+                return false; //the arc needs this free position
+            }
+        }
+        return arcs <= 1;
+    }
+}
+
+bool InferiorCells::IsDead(const AbstractBoard& board, int pos) {
+    int row = pos / board.GetSize();
+    int col = pos % board.GetSize();
+    Owner ring[RING_SIZE];
+    for (int i = 0; i < RING_SIZE; i++) {
+        ring[i] = GetOwner(board, row + RING_ROWS[i], col + RING_COLS[i]);
+    }
+    return IsUseless(ring, Owner::BLUE) && IsUseless(ring, Owner::RED);
+}
+
+unordered_set<int> InferiorCells::GetDeadPositions(const AbstractBoard& board) {
+    unordered_set<int> dead;
+    for (int pos : board.GetFreePositions()) {
+        if (IsDead(board, pos)) {
+            dead.insert(pos);
+        }
+    }
+    return dead;
+}
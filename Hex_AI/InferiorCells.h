@@ -0,0 +1,24 @@
+#ifndef __Hex_AI__InferiorCells__
+#define __Hex_AI__InferiorCells__
+
+#include <unordered_set>
+
+class AbstractBoard;
+
+/*
+ * Inferior cell analysis.
+ * A free position is dead if a stone there can't change who wins, whoever sets it.
+ * Looking at the 6 positions around it (including the board edges), a stone
+ * is useless for a player if the surrounding positions that the opponent doesn't
+ * own form a single arc in which every position but the two ends is the player's.
+ * Any path through the position can go around it through that arc instead.
+ * Dead positions stay dead when the board fills, so they never have to be simulated.
+ */
+namespace InferiorCells {
+    //Returns true if the free position is dead.
+    bool IsDead(const AbstractBoard& board, int pos);
+    //Returns the free positions of the board that are dead.
+    std::unordered_set<int> GetDeadPositions(const AbstractBoard& board);
+}
+
+#endif /* defined(__Hex_AI__InferiorCells__) */
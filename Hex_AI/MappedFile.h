@@ -0,0 +1,30 @@
+#ifndef __Hex_AI__MappedFile__
+#define __Hex_AI__MappedFile__
+
+#include <cstddef>
+#include <string>
+
+/*
+ * A file mapped read only into memory, so that its contents can be used
+ * without copying them. The mapping is released when the object is destroyed.
+ * Throws std::runtime_error if the file can't be opened or mapped.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* GetData() const {
+        return data_;
+    }
+    size_t GetSize() const {
+        return size_;
+    }
+private:
+    const char* data_;
+    size_t size_;
+};
+
+#endif /* defined(__Hex_AI__MappedFile__) */
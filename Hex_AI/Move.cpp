@@ -8,6 +8,23 @@ using namespace std;
 
 const string Move::AI_GIVE_UP_CODE = "Not being the smartest AI today";
 
+string Move::GetName(int pos, int board_size) {
+    int row = pos / board_size;
+    int col = pos % board_size;
+    string name(1, 'A' + col);
+    name.append(to_string(1 + row));
+    return name;
+}
+
+int Move::GetPosition(const string& name, int board_size) {
+    if (name.size() < 2 || name.size() > 4 || !isalpha(name[0]) || !isdigit(name[1])) return -1;
+    int col = toupper(name[0]) - 'A';
+    size_t digits;
+    int row = stoi(name.substr(1), &digits) - 1;
+    if (digits != name.size() - 1 || col >= board_size || row < 0 || row >= board_size) return -1;
+    return row * board_size + col;
+}
+
 MoveResult Move::Parse() {
     if (move_ == AI_GIVE_UP_CODE) {
         return MoveResult::COMPUTER_GAVE_UP;
@@ -55,7 +72,7 @@ bool Move::isOccupied() {
 
 bool Move::Apply(const Player& player) const {
     if (position_ >= 0) {
-        board_.AbstractBoard::Occupy(position_, player);
+        board_.Occupy(position_, player);
         cout << board_ << "\n---------------------------------------------" << endl;
         return true;
     }
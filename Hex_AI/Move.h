@@ -13,6 +13,10 @@ enum class MoveResult {
 class Move {
 public:
     static const std::string AI_GIVE_UP_CODE;
+    //Returns the name of a position: its letter followed by its number.
+    static std::string GetName(int pos, int board_size);
+    //Returns the position of a name, or -1 if it isn't a position of the board.
+    static int GetPosition(const std::string& name, int board_size);
     /**
      * move       The selected move as a letter followed by a number
      * board      The board on which the move will be applied
@@ -25,6 +29,10 @@ public:
     MoveResult Parse();
     /*If this move has been parsed and is valid, it applies the move and returns true.*/
     bool Apply(const Player&) const;
+    //Returns the position of a parsed move, or -1.
+    int GetNode() const {
+        return position_;
+    }
 private:
     int parseNode();
     bool isOccupied();
@@ -0,0 +1,97 @@
+#include "NeuralBatcher.h"
+
+#include <chrono>
+#include <stdexcept>
+
+#include "Trace.h"
+
+using namespace std;
+
+namespace {
+
+    //Time that a small batch waits for more requests.
+    const chrono::microseconds BATCH_WAIT(200);
+}
+
+NeuralBatcher::NeuralBatcher(unique_ptr<NeuralNetwork> network, int max_batch) :
+        network_(move(network)),
+        max_batch_(max(1, max_batch)) {
+    worker_ = thread([this] {
+        Run();
+    });
+}
+
+NeuralBatcher::~NeuralBatcher() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    worker_.join();
+}
+
+vector<NeuralNetwork::Output> NeuralBatcher::Evaluate(vector<NeuralNetwork::Input> inputs) {
+    if (inputs.empty()) {
+        return vector<NeuralNetwork::Output>();
+    }
+    Request request;
+    request.inputs = move(inputs);
+    future<vector<NeuralNetwork::Output>> outputs = request.outputs.get_future();
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (stop_) {
+            throw runtime_error("the network is stopped");
+        }
+        requests_.push_back(&request);
+        waiting_ += request.inputs.size();
+    }
+    condition_.notify_all();
+    //the request lives here until the worker has set its outputs
+    return outputs.get();
+}
+
+void NeuralBatcher::Run() {
+    unique_lock<mutex> lock(mutex_);
+    while (true) {
+        condition_.wait(lock, [this] {
+            return stop_ || !requests_.empty();
+        });
+        if (requests_.empty()) {
+            break; //stopped
+        }
+        if (waiting_ < max_batch_) {
+            condition_.wait_for(lock, BATCH_WAIT, [this] {
+                return stop_ || waiting_ >= max_batch_;
+            });
+        }
+        vector<Request*> batch;
+        vector<NeuralNetwork::Input> inputs;
+        while (!requests_.empty()
+                && (batch.empty() || inputs.size() + requests_.front()->inputs.size() <= max_batch_)) {
+            Request* request = requests_.front();
+            requests_.pop_front();
+            waiting_ -= request->inputs.size();
+            inputs.insert(inputs.end(), request->inputs.begin(), request->inputs.end());
+            batch.push_back(request);
+        }
+        lock.unlock();
+        try {
+            HEX_TRACE_SPAN("NeuralBatcher::Evaluate");
+            vector<NeuralNetwork::Output> outputs = network_->Evaluate(inputs);
+            evaluations_ += inputs.size();
+            batches_++;
+            auto output = outputs.begin();
+            for (Request* request : batch) {
+                auto end = output + request->inputs.size();
+                request->outputs.set_value(vector<NeuralNetwork::Output>(make_move_iterator(output),
+                                                                         make_move_iterator(end)));
+                output = end;
+            }
+        } catch (...) {
+            for (Request* request : batch) {
+                request->outputs.set_exception(current_exception());
+            }
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef __Hex_AI__NeuralBatcher__
+#define __Hex_AI__NeuralBatcher__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "NeuralNetwork.h"
+
+/*
+ * Evaluates positions for many threads with one network, gathering their requests into
+ * batches so that every layer goes through its weights once for all of them.
+ * A thread of its own runs the batches: it waits a little for more requests while the
+ * batch is small, so a lonely request is only delayed that much.
+ * It can be shared by all the AIs of a program.
+ */
+class NeuralBatcher {
+public:
+    static const int DEFAULT_MAX_BATCH = 64;
+
+    explicit NeuralBatcher(std::unique_ptr<NeuralNetwork> network, int max_batch = DEFAULT_MAX_BATCH);
+    //Evaluates the requests already made, and then stops its thread.
+    ~NeuralBatcher();
+    NeuralBatcher(const NeuralBatcher&) = delete;
+    NeuralBatcher& operator=(const NeuralBatcher&) = delete;
+
+    //Evaluates the positions in a batch with the ones of other threads, and waits for them.
+    //The positions of one call always go in the same batch, even if they are more than
+    //the maximum. Thread safe.
+    std::vector<NeuralNetwork::Output> Evaluate(std::vector<NeuralNetwork::Input> inputs);
+
+    const NeuralNetwork& GetNetwork() const {
+        return *network_;
+    }
+    //Returns the positions evaluated and the batches that evaluated them.
+    long long GetEvaluations() const {
+        return evaluations_.load();
+    }
+    long long GetBatches() const {
+        return batches_.load();
+    }
+private:
+    struct Request {
+        std::vector<NeuralNetwork::Input> inputs;
+        std::promise<std::vector<NeuralNetwork::Output>> outputs;
+    };
+
+    void Run();
+
+    const std::unique_ptr<NeuralNetwork> network_;
+    const size_t max_batch_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<Request*> requests_;
+    //positions of the waiting requests
+    size_t waiting_ = 0;
+    bool stop_ = false;
+    std::atomic<long long> evaluations_ { 0 };
+    std::atomic<long long> batches_ { 0 };
+    std::thread worker_;
+};
+
+#endif /* defined(__Hex_AI__NeuralBatcher__) */
@@ -0,0 +1,325 @@
+#include "NeuralNetwork.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "MappedFile.h"
+#include "Player.h"
+
+//The vector kernels are compiled for AVX2 and FMA on their own, and chosen at run time,
+//so the program runs on any x86 CPU without special build flags.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HEX_NEURAL_AVX2 1
+#include <immintrin.h>
+#else
+#define HEX_NEURAL_AVX2 0
+#endif
+
+using namespace std;
+
+namespace {
+
+    const char NETWORK_MAGIC[4] = { 'H', 'E', 'X', 'N' };
+    const uint32_t NETWORK_VERSION = 1;
+
+    struct NetworkHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t channels;
+        uint32_t layers;
+        uint32_t hidden;
+        uint32_t reserved[3];
+    };
+    static_assert(sizeof(NetworkHeader) == 32, "the header has no padding");
+
+    //A position and its 6 neighbors.
+    const int TAPS = 7;
+    //Floats in an AVX register.
+    const int VECTOR = 8;
+    const int MAX_LAYERS = 64;
+
+    int RoundUp(int value) {
+        return (value + VECTOR - 1) / VECTOR * VECTOR;
+    }
+
+    //Reads the floats of the file in order, its size is already checked.
+    class WeightReader {
+    public:
+        explicit WeightReader(const char* data) :
+                data_(data) {
+        }
+        //Reads rows x columns floats into a matrix with the given row stride.
+        void Read(vector<float>& matrix, int rows, int columns, int stride) {
+            for (int row = 0; row < rows; row++) {
+                memcpy(&matrix[row * stride], data_, columns * sizeof(float));
+                data_ += columns * sizeof(float);
+            }
+        }
+        float ReadOne() {
+            float value;
+            memcpy(&value, data_, sizeof(value));
+            data_ += sizeof(value);
+            return value;
+        }
+    private:
+        const char* data_;
+    };
+
+    //Sets every output channel of every position to the bias plus the sum of the inputs of
+    //the position and its neighbors times their weights, and applies the ReLU.
+    //taps has the row of the position and its neighbors, -1 outside the board.
+    void ConvolveScalar(const float* in, int in_stride, float* out, int out_stride,
+                        const int* taps, int cells, const float* weights, const float* biases) {
+        for (int cell = 0; cell < cells; cell++) {
+            float* result = out + cell * out_stride;
+            copy(biases, biases + out_stride, result);
+            for (int tap = 0; tap < TAPS; tap++) {
+                int source = taps[cell * TAPS + tap];
+                if (source < 0) continue;
+                const float* x = in + source * in_stride;
+                const float* w = weights + tap * in_stride * out_stride;
+                for (int i = 0; i < in_stride; i++, w += out_stride) {
+                    if (x[i] == 0) continue; //most are after the ReLU
+                    for (int o = 0; o < out_stride; o++) {
+                        result[o] += x[i] * w[o];
+                    }
+                }
+            }
+            for (int o = 0; o < out_stride; o++) {
+                result[o] = max(result[o], 0.0f);
+            }
+        }
+    }
+
+#if HEX_NEURAL_AVX2
+    //Same as ConvolveScalar, 32 output channels at a time in 4 registers while there are
+    //enough, and then 8 at a time.
+    __attribute__((target("avx2,fma")))
+    void ConvolveAvx2(const float* in, int in_stride, float* out, int out_stride,
+                      const int* taps, int cells, const float* weights, const float* biases) {
+        const __m256 zero = _mm256_setzero_ps();
+        for (int cell = 0; cell < cells; cell++) {
+            float* result = out + cell * out_stride;
+            const int* cell_taps = taps + cell * TAPS;
+            int o = 0;
+            for (; o + 4 * VECTOR <= out_stride; o += 4 * VECTOR) {
+                __m256 sum0 = _mm256_loadu_ps(biases + o);
+                __m256 sum1 = _mm256_loadu_ps(biases + o + VECTOR);
+                __m256 sum2 = _mm256_loadu_ps(biases + o + 2 * VECTOR);
+                __m256 sum3 = _mm256_loadu_ps(biases + o + 3 * VECTOR);
+                for (int tap = 0; tap < TAPS; tap++) {
+                    if (cell_taps[tap] < 0) continue;
+                    const float* x = in + cell_taps[tap] * in_stride;
+                    const float* w = weights + tap * in_stride * out_stride + o;
+                    for (int i = 0; i < in_stride; i++, w += out_stride) {
+                        __m256 value = _mm256_broadcast_ss(x + i);
+                        sum0 = _mm256_fmadd_ps(value, _mm256_loadu_ps(w), sum0);
+                        sum1 = _mm256_fmadd_ps(value, _mm256_loadu_ps(w + VECTOR), sum1);
+                        sum2 = _mm256_fmadd_ps(value, _mm256_loadu_ps(w + 2 * VECTOR), sum2);
+                        sum3 = _mm256_fmadd_ps(value, _mm256_loadu_ps(w + 3 * VECTOR), sum3);
+                    }
+                }
+                _mm256_storeu_ps(result + o, _mm256_max_ps(sum0, zero));
+                _mm256_storeu_ps(result + o + VECTOR, _mm256_max_ps(sum1, zero));
+                _mm256_storeu_ps(result + o + 2 * VECTOR, _mm256_max_ps(sum2, zero));
+                _mm256_storeu_ps(result + o + 3 * VECTOR, _mm256_max_ps(sum3, zero));
+            }
+            for (; o < out_stride; o += VECTOR) {
+                __m256 sum = _mm256_loadu_ps(biases + o);
+                for (int tap = 0; tap < TAPS; tap++) {
+                    if (cell_taps[tap] < 0) continue;
+                    const float* x = in + cell_taps[tap] * in_stride;
+                    const float* w = weights + tap * in_stride * out_stride + o;
+                    for (int i = 0; i < in_stride; i++, w += out_stride) {
+                        sum = _mm256_fmadd_ps(_mm256_broadcast_ss(x + i), _mm256_loadu_ps(w), sum);
+                    }
+                }
+                _mm256_storeu_ps(result + o, _mm256_max_ps(sum, zero));
+            }
+        }
+    }
+#endif
+
+    bool HasVectorInstructions() {
+#if HEX_NEURAL_AVX2
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+        return false;
+#endif
+    }
+
+    //FNV-1a of the bytes, never 0 so that 0 can mean no network.
+    uint32_t GetFileChecksum(const char* data, size_t size) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+        }
+        return hash == 0 ? 1 : hash;
+    }
+
+    //Returns the board position of a position of the network.
+    int GetBoardPos(int row, int col, int size, bool transposed) {
+        return transposed ? col * size + row : row * size + col;
+    }
+}
+
+NeuralNetwork::NeuralNetwork(const string& path) :
+        vectorized_(HasVectorInstructions()) {
+    MappedFile file(path);
+    NetworkHeader header;
+    if (file.GetSize() < sizeof(header)) {
+        throw runtime_error(path + " is not a network");
+    }
+    memcpy(&header, file.GetData(), sizeof(header));
+    if (memcmp(header.magic, NETWORK_MAGIC, sizeof(header.magic)) != 0
+            || header.version != NETWORK_VERSION) {
+        throw runtime_error(path + " is not a network of this version");
+    }
+    if (header.channels == 0 || header.channels > MAX_CHANNELS || header.layers == 0
+            || header.layers > MAX_LAYERS || header.hidden == 0 || header.hidden > MAX_CHANNELS) {
+        throw runtime_error(path + " has a network of a wrong shape");
+    }
+    checksum_ = GetFileChecksum(file.GetData(), file.GetSize());
+    channels_ = static_cast<int>(header.channels);
+    stride_ = RoundUp(channels_);
+    hidden_ = static_cast<int>(header.hidden);
+    size_t floats = 0;
+    for (uint32_t layer = 0; layer < header.layers; layer++) {
+        int inputs = layer == 0 ? INPUT_PLANES : channels_;
+        floats += static_cast<size_t>(TAPS) * inputs * channels_ + channels_;
+    }
+    floats += channels_ + 1 + channels_ * hidden_ + hidden_ + hidden_ + 1;
+    if (file.GetSize() != sizeof(header) + floats * sizeof(float)) {
+        throw runtime_error(path + " doesn't have the weights of its network");
+    }
+
+    WeightReader reader(file.GetData() + sizeof(header));
+    for (uint32_t index = 0; index < header.layers; index++) {
+        Layer layer;
+        layer.inputs = index == 0 ? INPUT_PLANES : channels_;
+        layer.input_stride = RoundUp(layer.inputs);
+        layer.weights.assign(TAPS * layer.input_stride * stride_, 0);
+        for (int tap = 0; tap < TAPS; tap++) {
+            vector<float> matrix(layer.inputs * stride_, 0);
+            reader.Read(matrix, layer.inputs, channels_, stride_);
+            copy(matrix.begin(), matrix.end(), layer.weights.begin() + tap * layer.input_stride * stride_);
+        }
+        layer.biases.assign(stride_, 0);
+        reader.Read(layer.biases, 1, channels_, stride_);
+        layers_.push_back(move(layer));
+    }
+    policy_weights_.assign(channels_, 0);
+    reader.Read(policy_weights_, 1, channels_, channels_);
+    policy_bias_ = reader.ReadOne();
+    value_weights_.assign(channels_ * hidden_, 0);
+    reader.Read(value_weights_, channels_, hidden_, hidden_);
+    value_biases_.assign(hidden_, 0);
+    reader.Read(value_biases_, 1, hidden_, hidden_);
+    output_weights_.assign(hidden_, 0);
+    reader.Read(output_weights_, 1, hidden_, hidden_);
+    output_bias_ = reader.ReadOne();
+}
+
+void NeuralNetwork::SetVectorized(bool vectorized) {
+    vectorized_ = vectorized && HasVectorInstructions();
+}
+
+vector<NeuralNetwork::Output> NeuralNetwork::Evaluate(const vector<Input>& batch) const {
+    //the positions of all the boards are rows of the same matrices, so every layer
+    //goes through its weights once for the whole batch
+    vector<int> first_cells;
+    int cells = 0;
+    for (const Input& input : batch) {
+        first_cells.push_back(cells);
+        cells += input.size * input.size;
+    }
+    vector<int> taps(cells * TAPS);
+    int max_stride = max(stride_, layers_.front().input_stride);
+    vector<float> activations(static_cast<size_t>(cells) * max_stride, 0);
+    vector<float> next(activations.size());
+    const int in_stride = layers_.front().input_stride;
+    for (size_t b = 0; b < batch.size(); b++) {
+        const Input& input = batch[b];
+        int n = input.size;
+        bool transposed = !input.to_move->PlaysFirst();
+        for (int row = 0; row < n; row++) {
+            for (int col = 0; col < n; col++) {
+                int cell = first_cells[b] + row * n + col;
+                //the neighbors in the order of ApplyAroundPosition, the transposed board has the same
+                const int rows[TAPS] = { row, row, row, row - 1, row - 1, row + 1, row + 1 };
+                const int cols[TAPS] = { col, col - 1, col + 1, col, col + 1, col - 1, col };
+                for (int tap = 0; tap < TAPS; tap++) {
+                    bool inside = rows[tap] >= 0 && rows[tap] < n && cols[tap] >= 0 && cols[tap] < n;
+                    taps[cell * TAPS + tap] = inside ? first_cells[b] + rows[tap] * n + cols[tap] : -1;
+                }
+                int stone = input.stones[GetBoardPos(row, col, n, transposed)];
+                float* planes = &activations[cell * in_stride];
+                planes[0] = stone == input.to_move->GetId() ? 1 : 0;
+                planes[1] = stone != 0 && stone != input.to_move->GetId() ? 1 : 0;
+                planes[2] = stone == 0 ? 1 : 0;
+                planes[3] = row == 0 || row == n - 1 ? 1 : 0;
+                planes[4] = col == 0 || col == n - 1 ? 1 : 0;
+            }
+        }
+    }
+
+    for (const Layer& layer : layers_) {
+#if HEX_NEURAL_AVX2
+        if (vectorized_) {
+            ConvolveAvx2(activations.data(), layer.input_stride, next.data(), stride_, taps.data(), cells,
+                         layer.weights.data(), layer.biases.data());
+        } else
+#endif
+        ConvolveScalar(activations.data(), layer.input_stride, next.data(), stride_, taps.data(), cells,
+                       layer.weights.data(), layer.biases.data());
+        activations.swap(next);
+    }
+
+    vector<Output> outputs(batch.size());
+    for (size_t b = 0; b < batch.size(); b++) {
+        const Input& input = batch[b];
+        int n = input.size;
+        bool transposed = !input.to_move->PlaysFirst();
+        Output& output = outputs[b];
+        output.policy.assign(n * n, 0);
+        vector<float> means(channels_, 0);
+        vector<float> logits(n * n);
+        float max_logit = -INFINITY;
+        for (int cell = 0; cell < n * n; cell++) {
+            const float* x = &activations[(first_cells[b] + cell) * stride_];
+            float logit = policy_bias_;
+            for (int c = 0; c < channels_; c++) {
+                logit += x[c] * policy_weights_[c];
+                means[c] += x[c] / (n * n);
+            }
+            logits[cell] = logit;
+            if (input.stones[GetBoardPos(cell / n, cell % n, n, transposed)] == 0) {
+                max_logit = max(max_logit, logit);
+            }
+        }
+        float total = 0;
+        for (int cell = 0; cell < n * n; cell++) {
+            int pos = GetBoardPos(cell / n, cell % n, n, transposed);
+            if (input.stones[pos] != 0) continue;
+            output.policy[pos] = exp(logits[cell] - max_logit);
+            total += output.policy[pos];
+        }
+        for (float& it : output.policy) {
+            if (total > 0) it /= total;
+        }
+        float value = output_bias_;
+        for (int h = 0; h < hidden_; h++) {
+            float sum = value_biases_[h];
+            for (int c = 0; c < channels_; c++) {
+                sum += means[c] * value_weights_[c * hidden_ + h];
+            }
+            value += max(sum, 0.0f) * output_weights_[h];
+        }
+        output.value = 1 / (1 + exp(-value));
+    }
+    return outputs;
+}
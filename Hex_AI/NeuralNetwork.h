@@ -0,0 +1,89 @@
+#ifndef __Hex_AI__NeuralNetwork__
+#define __Hex_AI__NeuralNetwork__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Player;
+
+/*
+ * A small convolutional network that evaluates positions on the CPU, for any board size.
+ * It reads the board from the side of the player to move: the board is transposed when
+ * that player connects the columns, so that the network always connects the rows.
+ * The input of every position has 5 planes: stones of the player to move, stones of the
+ * opponent, free, edge of the player to move and edge of the opponent.
+ * Every layer convolves a position with itself and its 6 neighbors, the outside of the
+ * board is 0, and applies a ReLU. Then two heads read the last layer:
+ * policy  A logit for every position, turned into probabilities over the free ones.
+ * value   The mean of every channel over the board, a hidden layer with ReLU and
+ *         a sigmoid, the chances of the player to move.
+ *
+ * The weights file has a header of 32 bytes:
+ *   "HEXN", version, channels, layers, hidden value units, 3 zeros
+ * followed by the float weights of every layer, [7 taps][inputs][channels] and
+ * [channels] biases, with the taps in the order of the center and the neighbors of
+ * ApplyAroundPosition; the policy head, [channels] and 1 bias; and the value head,
+ * [channels][hidden] and [hidden] biases, then [hidden] and 1 bias.
+ * Numbers are little endian like the machines that run the engine.
+ *
+ * The convolutions use AVX2 and FMA when the CPU has them, or else plain loops.
+ */
+class NeuralNetwork {
+public:
+    static const int INPUT_PLANES = 5;
+    static const int MAX_CHANNELS = 256;
+
+    struct Input {
+        //player id of every position, 0 if it is free
+        std::vector<int> stones;
+        int size;
+        const Player* to_move;
+    };
+    struct Output {
+        //probability of every position of the board, 0 for the occupied ones
+        std::vector<float> policy;
+        //chances of the player to move
+        float value;
+    };
+
+    //Reads the weights. Throws std::runtime_error if the file isn't a network of this version.
+    explicit NeuralNetwork(const std::string& path);
+
+    //Evaluates many positions at once, they can have different sizes. Thread safe.
+    std::vector<Output> Evaluate(const std::vector<Input>& batch) const;
+
+    //Returns a checksum of the weights file, to know if two networks are the same.
+    uint32_t GetChecksum() const {
+        return checksum_;
+    }
+    //Returns true if the convolutions use the vector instructions.
+    bool IsVectorized() const {
+        return vectorized_;
+    }
+    //Uses the plain loops even if the CPU has the vector instructions, to compare them.
+    void SetVectorized(bool vectorized);
+private:
+    struct Layer {
+        int inputs;
+        //padded to whole vectors, the padding has zero weights
+        int input_stride;
+        std::vector<float> weights;
+        std::vector<float> biases;
+    };
+
+    int channels_;
+    int stride_; //channels padded to whole vectors
+    int hidden_;
+    std::vector<Layer> layers_;
+    std::vector<float> policy_weights_;
+    float policy_bias_;
+    std::vector<float> value_weights_;
+    std::vector<float> value_biases_;
+    std::vector<float> output_weights_;
+    float output_bias_;
+    uint32_t checksum_;
+    bool vectorized_;
+};
+
+#endif /* defined(__Hex_AI__NeuralNetwork__) */
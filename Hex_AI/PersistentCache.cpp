@@ -0,0 +1,182 @@
+#include "PersistentCache.h"
+
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+//The slots live in the file, so their atomics must work without locks between processes.
+//Zeros are an empty slot that nobody is writing.
+struct PersistentCache::Slot {
+    atomic<uint32_t> sequence;
+    atomic<int32_t> wins;
+    atomic<uint64_t> key;
+    atomic<int32_t> simulations;
+    atomic<int32_t> blocks;
+    //bits of the doubles
+    atomic<uint64_t> block_ratios;
+    atomic<uint64_t> block_squares;
+    uint64_t reserved[3];
+};
+
+namespace {
+
+    const char CACHE_MAGIC[4] = { 'H', 'E', 'X', 'C' };
+    const uint32_t CACHE_VERSION = 1;
+
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t slot_size;
+        uint32_t reserved;
+        uint64_t slot_count;
+        uint64_t reserved2[5];
+    };
+    static_assert(sizeof(CacheHeader) == 64, "the header has no padding");
+    static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+                  "the slots are shared between processes without locks");
+
+    //Slots where a key can be, they share 4 cache lines.
+    const size_t BUCKET_SLOTS = 4;
+
+    bool IsPowerOfTwo(uint64_t value) {
+        return value != 0 && (value & (value - 1)) == 0;
+    }
+
+    uint64_t GetBits(double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    double GetDouble(uint64_t bits) {
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+PersistentCache::PersistentCache(const string& path, size_t slots) :
+        data_(nullptr), size_(0), slot_count_(0) {
+    static_assert(sizeof(Slot) == 64, "a slot is a cache line");
+    if (slots < BUCKET_SLOTS || !IsPowerOfTwo(slots)) {
+        throw runtime_error("the slots of a cache must be a power of 2");
+    }
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw runtime_error("can't open " + path);
+    }
+    try {
+        //the first process writes the header while the others wait, closing the file unlocks it
+        if (flock(fd, LOCK_EX) != 0) {
+            throw runtime_error("can't lock " + path);
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            throw runtime_error("can't read the size of " + path);
+        }
+        CacheHeader header;
+        if (info.st_size == 0) {
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+            header.version = CACHE_VERSION;
+            header.slot_size = sizeof(Slot);
+            header.slot_count = slots;
+            //the new slots are zeros
+            if (ftruncate(fd, sizeof(header) + slots * sizeof(Slot)) != 0
+                    || pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+                throw runtime_error("can't create the cache " + path);
+            }
+        } else if (pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+                || memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0
+                || header.version != CACHE_VERSION || header.slot_size != sizeof(Slot)
+                || !IsPowerOfTwo(header.slot_count) || header.slot_count < BUCKET_SLOTS
+                || static_cast<uint64_t>(info.st_size) != sizeof(header) + header.slot_count * sizeof(Slot)) {
+            throw runtime_error(path + " is not a cache of this version");
+        }
+        slot_count_ = header.slot_count;
+        size_ = sizeof(header) + slot_count_ * sizeof(Slot);
+        void* data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            throw runtime_error("can't map " + path);
+        }
+        data_ = static_cast<char*>(data);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    //the mapping stays valid without the descriptor
+    close(fd);
+}
+
+PersistentCache::~PersistentCache() {
+    munmap(data_, size_);
+}
+
+PersistentCache::Slot* PersistentCache::GetBucket(uint64_t key) const {
+    Slot* slots = reinterpret_cast<Slot*>(data_ + sizeof(CacheHeader));
+    return slots + (key & (slot_count_ - 1) & ~(BUCKET_SLOTS - 1));
+}
+
+bool PersistentCache::Find(uint64_t key, SimulationTally& tally) const {
+    Slot* bucket = GetBucket(key);
+    for (size_t i = 0; i < BUCKET_SLOTS; i++) {
+        Slot& slot = bucket[i];
+        uint32_t sequence = slot.sequence.load(memory_order_acquire);
+        if (sequence % 2 != 0 || slot.key.load(memory_order_relaxed) != key) continue;
+        SimulationTally::Counters counters;
+        counters.wins = slot.wins.load(memory_order_relaxed);
+        counters.simulations = slot.simulations.load(memory_order_relaxed);
+        counters.blocks = slot.blocks.load(memory_order_relaxed);
+        counters.block_ratios = GetDouble(slot.block_ratios.load(memory_order_relaxed));
+        counters.block_squares = GetDouble(slot.block_squares.load(memory_order_relaxed));
+        //the copy is only good if nobody wrote the slot meanwhile
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.sequence.load(memory_order_relaxed) != sequence || counters.simulations <= 0) continue;
+        tally = SimulationTally(counters);
+        return true;
+    }
+    return false;
+}
+
+void PersistentCache::Store(uint64_t key, const SimulationTally& tally) {
+    SimulationTally::Counters counters = tally.GetCounters();
+    if (counters.simulations <= 0) return;
+    Slot* bucket = GetBucket(key);
+    Slot* target = nullptr;
+    for (size_t i = 0; i < BUCKET_SLOTS && target == nullptr; i++) {
+        if (bucket[i].key.load(memory_order_relaxed) == key) {
+            target = &bucket[i];
+        }
+    }
+    if (target == nullptr) {
+        //a slot being written, or left odd by a writer that died, is never replaced
+        for (size_t i = 0; i < BUCKET_SLOTS; i++) {
+            if (bucket[i].sequence.load(memory_order_relaxed) % 2 != 0) continue;
+            if (target == nullptr
+                    || bucket[i].simulations.load(memory_order_relaxed) < target->simulations.load(memory_order_relaxed)) {
+                target = &bucket[i];
+            }
+        }
+        if (target == nullptr) return;
+    }
+    uint32_t sequence = target->sequence.load(memory_order_relaxed);
+    if (sequence % 2 != 0
+            || !target->sequence.compare_exchange_strong(sequence, sequence + 1, memory_order_acquire)) {
+        return; //someone else is writing it
+    }
+    atomic_thread_fence(memory_order_release);
+    target->key.store(key, memory_order_relaxed);
+    target->wins.store(counters.wins, memory_order_relaxed);
+    target->simulations.store(counters.simulations, memory_order_relaxed);
+    target->blocks.store(counters.blocks, memory_order_relaxed);
+    target->block_ratios.store(GetBits(counters.block_ratios), memory_order_relaxed);
+    target->block_squares.store(GetBits(counters.block_squares), memory_order_relaxed);
+    target->sequence.store(sequence + 2, memory_order_release);
+}
@@ -0,0 +1,56 @@
+#ifndef __Hex_AI__PersistentCache__
+#define __Hex_AI__PersistentCache__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Simulation.h"
+
+/*
+ * Simulation results of positions kept in a file mapped into memory, so that they
+ * survive the process and are shared by all the processes that map the same file.
+ * Opening it only maps the file, the results are read when they are looked up.
+ *
+ * The file has a header of 64 bytes:
+ *   "HEXC", version, slot size, 0, slot count, 40 zeros
+ * followed by the slots of 64 bytes. A key goes to a bucket of 4 slots, and a new key
+ * replaces the slot of the bucket with fewest simulations.
+ * Every slot has a sequence number that is odd while it is written: a reader copies the slot
+ * and takes it as missing if the number changed, and a writer that finds it odd drops its
+ * results, so no process waits for another one. A process that dies while it writes
+ * leaves the slot odd for good: it is never read nor chosen to be replaced again, and the
+ * bucket goes on with its other slots. Numbers are little endian like the machines that run the engine.
+ */
+class PersistentCache {
+public:
+    static const size_t DEFAULT_SLOTS = 1 << 20;
+
+    /*
+     * Maps the file, or creates it with the given slots, a power of 2, if it doesn't exist.
+     * Throws std::runtime_error if it can't, or if the file isn't a cache of this version.
+     */
+    explicit PersistentCache(const std::string& path, size_t slots = DEFAULT_SLOTS);
+    ~PersistentCache();
+    PersistentCache(const PersistentCache&) = delete;
+    PersistentCache& operator=(const PersistentCache&) = delete;
+
+    //Returns true and copies the stored results if the position is in the cache. Thread safe.
+    bool Find(uint64_t key, SimulationTally& tally) const;
+    //Stores the results of a position, replacing the previous ones. It can be dropped if
+    //another thread or process is writing the same slot. Thread safe.
+    void Store(uint64_t key, const SimulationTally& tally);
+    size_t GetSlots() const {
+        return slot_count_;
+    }
+private:
+    struct Slot;
+
+    Slot* GetBucket(uint64_t key) const;
+
+    char* data_;
+    size_t size_;
+    size_t slot_count_;
+};
+
+#endif /* defined(__Hex_AI__PersistentCache__) */
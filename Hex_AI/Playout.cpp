@@ -0,0 +1,84 @@
+#include "Playout.h"
+
+#include <cassert>
+
+#include "AbstractBoard.h"
+#include "HexTopology.h"
+
+using namespace std;
+
+namespace {
+
+    //Every position keeps the fillings in which it is reached from the first edge.
+    //The neighbors come from the compile time table and the loops over them are unrolled.
+    template<int N>
+    unsigned GetWinningFills(const AbstractBoard& board,
+                             const vector<unsigned char>& fills,
+                             bool connect_letters) {
+        typedef HexTopology<N> Topology;
+        const unsigned all_fills = 0xFF;
+        unsigned char owned[Topology::POSITIONS + 1];
+        unsigned char reached[Topology::POSITIONS + 1] = { };
+        bool queued[Topology::POSITIONS] = { };
+        int stack[Topology::POSITIONS];
+        int stack_size = 0;
+        for (int pos = 0; pos < Topology::POSITIONS; pos++) {
+            owned[pos] = board.IsOccupied(pos) ? all_fills : fills[pos];
+        }
+        owned[Topology::WALL] = 0;
+
+        const int second_edge = connect_letters ? Topology::LAST_ROW : Topology::LAST_COL;
+        for (int i = 0; i < N; i++) {
+            int pos = connect_letters ? i : i * N;
+            reached[pos] = owned[pos];
+            if (reached[pos] != 0) {
+                queued[pos] = true;
+                stack[stack_size++] = pos;
+            }
+        }
+        unsigned winners = 0;
+        while (stack_size > 0) {
+            int current = stack[--stack_size];
+            queued[current] = false;
+            const typename Topology::Cell& cell = Topology::GetCell(current);
+            if (cell.edges & second_edge) {
+                winners |= reached[current];
+            }
+            for (int dir = 0; dir < Topology::DIRECTIONS; dir++) {
+                int next = cell.neighbors[dir];
+                unsigned added = reached[current] & owned[next] & ~reached[next];
+                if (added != 0) {
+                    reached[next] |= added;
+                    if (!queued[next]) {
+                        queued[next] = true;
+                        stack[stack_size++] = next;
+                    }
+                }
+            }
+        }
+        return winners;
+    }
+
+    //Fills the table of kernels from size N down to the minimum size.
+    template<int N>
+    struct KernelTable {
+        static void Fill(Playout::WinningFillsFunction* table) {
+            table[N] = &GetWinningFills<N>;
+            KernelTable<N - 1>::Fill(table);
+        }
+    };
+
+    template<>
+    struct KernelTable<HexConst::MIN_BOARD_SIZE - 1> {
+        static void Fill(Playout::WinningFillsFunction*) {
+        }
+    };
+}
+
+Playout::WinningFillsFunction Playout::GetWinningFillsFunction(int size) {
+    static Playout::WinningFillsFunction table[MAX_KERNEL_SIZE + 1] = { };
+    static bool filled = (KernelTable<MAX_KERNEL_SIZE>::Fill(table), true);
+    (void) filled;
+    assert(size >= HexConst::MIN_BOARD_SIZE && size <= MAX_KERNEL_SIZE);
+    return table[size];
+}
@@ -0,0 +1,32 @@
+#ifndef __Hex_AI__Playout__
+#define __Hex_AI__Playout__
+
+#include <vector>
+
+#include "HexConst.h"
+
+class AbstractBoard;
+
+namespace Playout {
+    //Biggest board size with a compiled playout kernel.
+    const int MAX_KERNEL_SIZE = HexConst::MAX_BOARD_SIZE;
+    static_assert(HexConst::MAX_BOARD_SIZE <= MAX_KERNEL_SIZE,
+            "every playable board size needs a playout kernel");
+
+    /*
+     * Checks up to 8 fillings of a board with a single flood fill.
+     * board            Has the AI's stones. Other occupied positions are ignored.
+     * fills            Bit i is set if the AI occupies the free position in the filling i.
+     * connect_letters  True if the AI connects the first and the last rows
+     * Returns a mask with bit i set if the AI connects its edges in the filling i.
+     */
+    typedef unsigned (*WinningFillsFunction)(const AbstractBoard& board,
+                                             const std::vector<unsigned char>& fills,
+                                             bool connect_letters);
+
+    //Returns the kernel compiled for the board size.
+    //It is looked up once per board, so the kernels can use the size as a constant.
+    WinningFillsFunction GetWinningFillsFunction(int size);
+}
+
+#endif /* defined(__Hex_AI__Playout__) */
@@ -0,0 +1,244 @@
+#include "Resistance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "AbstractBoard.h"
+#include "Player.h"
+
+using namespace std;
+
+namespace {
+
+    //Resistance of a position occupied by the player. It is not 0 to keep
+    //the equations well conditioned.
+    const double STONE_RESISTANCE = 0.01;
+    const double FREE_RESISTANCE = 1.0;
+
+    //The solver stops when the residual is this fraction of the initial one.
+    const double TOLERANCE = 1e-6;
+
+    const Player& GetOpponent(const Player& player) {
+        return player == Player::BLUE_PLAYER ? Player::RED_PLAYER : Player::BLUE_PLAYER;
+    }
+
+    //Symmetric sparse matrix in compressed rows, without the diagonal.
+    struct SparseMatrix {
+        vector<int> row_start;
+        vector<int> cols;
+        vector<double> values;
+        vector<double> diagonal;
+    };
+
+    //result = matrix * x
+    void Multiply(const SparseMatrix& matrix, const vector<double>& x, vector<double>& result) {
+        int rows = static_cast<int>(matrix.diagonal.size());
+        for (int i = 0; i < rows; i++) {
+            double sum = matrix.diagonal[i] * x[i];
+            for (int k = matrix.row_start[i]; k < matrix.row_start[i + 1]; k++) {
+                sum += matrix.values[k] * x[matrix.cols[k]];
+            }
+            result[i] = sum;
+        }
+    }
+
+    double Dot(const vector<double>& a, const vector<double>& b) {
+        double sum = 0;
+        for (size_t i = 0; i < a.size(); i++) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+    //Solves matrix * x = b with the conjugate gradient method.
+    //The matrix has to be symmetric and positive semidefinite, with b
+    //in its column space.
+    vector<double> SolveConjugateGradient(const SparseMatrix& matrix, const vector<double>& b) {
+        size_t rows = b.size();
+        vector<double> x(rows);
+        vector<double> residual = b;
+        vector<double> direction = residual;
+        vector<double> product(rows);
+        double residual_norm = Dot(residual, residual);
+        double stop_norm = residual_norm * TOLERANCE * TOLERANCE;
+        for (size_t it = 0; it < 2 * rows && residual_norm > stop_norm; it++) {
+            Multiply(matrix, direction, product);
+            double alpha = residual_norm / Dot(direction, product);
+            for (size_t i = 0; i < rows; i++) {
+                x[i] += alpha * direction[i];
+                residual[i] -= alpha * product[i];
+            }
+            double new_norm = Dot(residual, residual);
+            double beta = new_norm / residual_norm;
+            residual_norm = new_norm;
+            for (size_t i = 0; i < rows; i++) {
+                direction[i] = residual[i] + beta * direction[i];
+            }
+        }
+        return x;
+    }
+}
+
+double ResistanceEvaluator::GetResistance(const AbstractBoard& board, const Player& player) const {
+    return GetResistance(GetStones(board), board.GetSize(), player);
+}
+
+double ResistanceEvaluator::Evaluate(const AbstractBoard& board, const Player& player) const {
+    return Evaluate(GetStones(board), board.GetSize(), player);
+}
+
+double ResistanceEvaluator::EvaluateMove(const AbstractBoard& board,
+                                         int pos,
+                                         const Player& player) const {
+    vector<int> stones = GetStones(board);
+    stones[pos] = player.GetId();
+    return Evaluate(stones, board.GetSize(), player);
+}
+
+vector<int> ResistanceEvaluator::SortMoves(vector<int> stones,
+                                           int size,
+                                           const unordered_set<int>& positions,
+                                           const Player& player) const {
+    vector<pair<double, int>> values;
+    for (int pos : positions) {
+        stones[pos] = player.GetId();
+        values.push_back(make_pair(-Evaluate(stones, size, player), pos));
+        stones[pos] = 0;
+    }
+    sort(values.begin(), values.end());
+    vector<int> sorted;
+    for (auto& it : values) {
+        sorted.push_back(it.second);
+    }
+    return sorted;
+}
+
+//The value is the share of the opponent's resistance in the sum of both resistances.
+double ResistanceEvaluator::Evaluate(const vector<int>& stones,
+                                     int size,
+                                     const Player& player) const {
+    double own = GetResistance(stones, size, player);
+    double other = GetResistance(stones, size, GetOpponent(player));
+    if (own < 0) return 0;
+    if (other < 0) return 1;
+    return other / (own + other);
+}
+
+//Sets the potential of one edge to 1 and the other one to 0 and calculates
+//the current between them.
+double ResistanceEvaluator::GetResistance(const vector<int>& stones,
+                                          int size,
+                                          const Player& player) const {
+    Circuit circuit = MakeCircuit(stones, size, player);
+    vector<double> potentials = GetPotentials(circuit);
+    int sink = circuit.GetSize() - 2;
+    double current = 0;
+    circuit.ApplyToNeighbors(sink, [&](int node, double conductance) {
+        current += conductance * potentials[node];
+    });
+    return current > 0 ? 1 / current : -1;
+}
+
+//The current through a position is half the sum of the currents of its resistors,
+//since all that comes in goes out.
+vector<int> ResistanceEvaluator::SortByCurrent(const vector<int>& stones,
+                                               int size,
+                                               const unordered_set<int>& positions,
+                                               const Player& player) const {
+    Circuit circuit = MakeCircuit(stones, size, player);
+    vector<double> potentials = GetPotentials(circuit);
+    vector<pair<double, int>> values;
+    for (int pos : positions) {
+        double current = 0;
+        circuit.ApplyToNeighbors(pos, [&](int other, double conductance) {
+            current += conductance * fabs(potentials[pos] - potentials[other]);
+        });
+        values.push_back(make_pair(-current / 2, pos));
+    }
+    sort(values.begin(), values.end());
+    vector<int> sorted;
+    for (auto& it : values) {
+        sorted.push_back(it.second);
+    }
+    return sorted;
+}
+
+vector<double> ResistanceEvaluator::GetPotentials(const Circuit& circuit) const {
+    int total_nodes = circuit.GetSize();
+    int source = total_nodes - 1;
+    int sink = total_nodes - 2;
+    //the unknown potentials are the ones of the positions,
+    //they have the same index in the matrix as in the graph
+    int unknowns = total_nodes - 2;
+    SparseMatrix matrix;
+    matrix.diagonal.assign(unknowns, 0);
+    vector<double> b(unknowns);
+    for (int node = 0; node < unknowns; node++) {
+        matrix.row_start.push_back(static_cast<int>(matrix.cols.size()));
+        circuit.ApplyToNeighbors(node, [&](int other, double conductance) {
+            matrix.diagonal[node] += conductance;
+            if (other == source) {
+                b[node] += conductance;
+            } else if (other != sink) {
+                matrix.cols.push_back(other);
+                matrix.values.push_back(-conductance);
+            }
+        });
+    }
+    matrix.row_start.push_back(static_cast<int>(matrix.cols.size()));
+
+    vector<double> potentials = SolveConjugateGradient(matrix, b);
+    potentials.resize(total_nodes);
+    potentials[sink] = 0;
+    potentials[source] = 1;
+    return potentials;
+}
+
+ResistanceEvaluator::Circuit ResistanceEvaluator::MakeCircuit(const vector<int>& stones,
+                                               int size,
+                                               const Player& player) const {
+    int total_pos = size * size;
+    //2 extra nodes for the edges, like in the boards
+    Circuit circuit(total_pos + 2);
+    int first_virtual = total_pos + 1;
+    int second_virtual = total_pos;
+    vector<double> resistances(total_pos);
+    for (int pos = 0; pos < total_pos; pos++) {
+        resistances[pos] = stones[pos] == player.GetId() ? STONE_RESISTANCE : FREE_RESISTANCE;
+    }
+    const int opponent_id = GetOpponent(player).GetId();
+    auto usable = [&stones, opponent_id](int pos, const Player*) {
+        return stones[pos] != opponent_id;
+    };
+    for (int pos = 0; pos < total_pos; pos++) {
+        if (!usable(pos, nullptr)) continue;
+        ApplyAroundPosition(pos, nullptr, size, [&](int x, int y, const Player*) {
+            circuit.SetEdge(x, y, 1 / (resistances[x] + resistances[y]));
+        }, usable);
+        //the first player connects the rows and the second one the columns
+        int line = player.PlaysFirst() ? pos / size : pos % size;
+        if (line == 0) {
+            circuit.SetEdge(pos, player.PlaysFirst() ? first_virtual : second_virtual,
+                            1 / resistances[pos]);
+        }
+        if (line == size - 1) {
+            circuit.SetEdge(pos, player.PlaysFirst() ? second_virtual : first_virtual,
+                            1 / resistances[pos]);
+        }
+    }
+    return circuit;
+}
+
+vector<int> ResistanceEvaluator::GetStones(const AbstractBoard& board) const {
+    int total_pos = board.GetSize() * board.GetSize();
+    vector<int> stones(total_pos);
+    for (int pos = 0; pos < total_pos; pos++) {
+        if (board.Belongs(pos, Player::BLUE_PLAYER)) {
+            stones[pos] = Player::BLUE_PLAYER.GetId();
+        } else if (board.Belongs(pos, Player::RED_PLAYER)) {
+            stones[pos] = Player::RED_PLAYER.GetId();
+        }
+    }
+    return stones;
+}
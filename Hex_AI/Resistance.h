@@ -0,0 +1,64 @@
+#ifndef __Hex_AI__Resistance__
+#define __Hex_AI__Resistance__
+
+#include <unordered_set>
+#include <vector>
+
+#include "AbstractBoard.h"
+#include "Graph.h"
+
+class Player;
+
+/*
+ * Evaluates positions by modeling the board as a circuit of resistors for each player.
+ * Every position is a node, plus two nodes for the edges that the player has to connect.
+ * A free position has a resistance of 1, a stone of the player almost none and
+ * a stone of the opponent breaks the circuit. Two adjacent nodes are connected
+ * with the sum of their resistances.
+ * The lower the resistance between the edges, the closer the player is to winning.
+ * The circuit is solved with the conjugate gradient method over its sparse equations.
+ */
+class ResistanceEvaluator {
+public:
+    //Every node has at most 6 neighbors plus an edge, so the circuit is sparse.
+    typedef Graph<double, SparseStorage> Circuit;
+
+    //Returns the resistance between the player's edges, or a negative number if
+    //the opponent has cut every path.
+    double GetResistance(const AbstractBoard& board, const Player& player) const;
+    //Returns how good the board is for the player, between 0 and 1.
+    double Evaluate(const AbstractBoard& board, const Player& player) const;
+    //Returns how good the board would be for the player if it occupied the position.
+    double EvaluateMove(const AbstractBoard& board, int pos, const Player& player) const;
+    //Returns the positions sorted from the best to the worst for the player to occupy.
+    std::vector<int> SortMoves(const AbstractBoard& board,
+                               const std::unordered_set<int>& positions,
+                               const Player& player) const {
+        return SortMoves(GetStones(board), board.GetSize(), positions, player);
+    }
+
+    //The following work on the player id of every position (0 if it is free),
+    //so that positions that are not on a board can be evaluated.
+    std::vector<int> GetStones(const AbstractBoard& board) const;
+    double Evaluate(const std::vector<int>& stones, int size, const Player& player) const;
+    std::vector<int> SortMoves(std::vector<int> stones,
+                               int size,
+                               const std::unordered_set<int>& positions,
+                               const Player& player) const;
+    //Returns the positions sorted from the most to the least current that flows through them
+    //in the player's circuit. It solves the circuit only once, so it is much faster
+    //than SortMoves for many positions, but less accurate.
+    std::vector<int> SortByCurrent(const std::vector<int>& stones,
+                                   int size,
+                                   const std::unordered_set<int>& positions,
+                                   const Player& player) const;
+private:
+    double GetResistance(const std::vector<int>& stones, int size, const Player& player) const;
+    //Returns the potential of every node when the first edge is at 1 and the second one at 0.
+    std::vector<double> GetPotentials(const Circuit& circuit) const;
+    Circuit MakeCircuit(const std::vector<int>& stones,
+                              int size,
+                              const Player& player) const;
+};
+
+#endif /* defined(__Hex_AI__Resistance__) */
@@ -0,0 +1,62 @@
+#include "SearchCache.h"
+
+#include <algorithm>
+
+#include "PersistentCache.h"
+
+using namespace std;
+
+void SearchCache::SetPersistentCache(shared_ptr<PersistentCache> persistent, int board_size) {
+    persistent_ = move(persistent);
+    board_size_ = board_size;
+}
+
+void SearchCache::NewTurn() {
+    turn_++;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        it = turn_ - it->second.turn > MAX_AGE ? entries_.erase(it) : next(it);
+    }
+}
+
+bool SearchCache::Find(uint64_t key, SimulationTally& tally) const {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        return persistent_ != nullptr && persistent_->Find(GetPersistentKey(key), tally);
+    }
+    tally = it->second.tally;
+    return true;
+}
+
+void SearchCache::Store(uint64_t key, const SimulationTally& tally) {
+    if (entries_.size() >= max_entries_ && entries_.count(key) == 0) {
+        EvictOldestTurn();
+    }
+    Entry& entry = entries_[key];
+    entry.tally = tally;
+    entry.turn = turn_;
+    if (persistent_ != nullptr) {
+        persistent_->Store(GetPersistentKey(key), tally);
+    }
+}
+
+uint64_t SearchCache::GetPersistentKey(uint64_t key) const {
+    return MixSeed(key, board_size_, 0);
+}
+
+//Evicts every entry of the oldest turn. If all of them are from the current turn,
+//it evicts a tenth of the cache.
+void SearchCache::EvictOldestTurn() {
+    int oldest = turn_;
+    for (auto& it : entries_) {
+        oldest = min(oldest, it.second.turn);
+    }
+    size_t to_evict = oldest == turn_ ? max(max_entries_ / 10, size_t(1)) : entries_.size();
+    for (auto it = entries_.begin(); it != entries_.end() && to_evict > 0;) {
+        if (it->second.turn == oldest) {
+            it = entries_.erase(it);
+            to_evict--;
+        } else {
+            ++it;
+        }
+    }
+}
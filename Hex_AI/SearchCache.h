@@ -0,0 +1,65 @@
+#ifndef __Hex_AI__SearchCache__
+#define __Hex_AI__SearchCache__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "Simulation.h"
+
+class PersistentCache;
+
+/*
+ * Keeps the simulation results of the positions reached by a computer move and
+ * an opponent response, so that they survive between turns.
+ * Positions are identified by their Zobrist key.
+ * Every entry remembers the turn in which it was last stored. When the cache is
+ * full, the entries of the oldest turn are evicted, and entries that are too old
+ * to be reached again are evicted at the start of every turn.
+ * It can be backed by a PersistentCache: the results are also stored there, and the
+ * positions that are not in memory are looked up there.
+ */
+class SearchCache {
+public:
+    static const size_t DEFAULT_MAX_ENTRIES = 1 << 18;
+    //Turns after which an entry can't be useful anymore.
+    static const int MAX_AGE = 2;
+
+    explicit SearchCache(size_t max_entries = DEFAULT_MAX_ENTRIES) :
+            max_entries_(max_entries) {
+    }
+
+    //Keeps the results in the persistent cache too. The keys don't depend on the board
+    //size, so the size tells apart the positions of different boards there.
+    void SetPersistentCache(std::shared_ptr<PersistentCache> persistent, int board_size);
+    bool HasPersistentCache() const {
+        return persistent_ != nullptr;
+    }
+    //Starts a new turn and evicts the entries that are too old.
+    void NewTurn();
+    //Returns true and copies the stored results if the position is in the cache.
+    //Thread safe, as long as nothing is stored at the same time.
+    bool Find(uint64_t key, SimulationTally& tally) const;
+    //Stores the results of a position, replacing the previous ones.
+    void Store(uint64_t key, const SimulationTally& tally);
+    size_t GetSize() const {
+        return entries_.size();
+    }
+private:
+    struct Entry {
+        SimulationTally tally;
+        int turn;
+    };
+
+    void EvictOldestTurn();
+    uint64_t GetPersistentKey(uint64_t key) const;
+
+    const size_t max_entries_;
+    int turn_ = 0;
+    std::unordered_map<uint64_t, Entry> entries_;
+    std::shared_ptr<PersistentCache> persistent_;
+    int board_size_ = 0;
+};
+
+#endif /* defined(__Hex_AI__SearchCache__) */
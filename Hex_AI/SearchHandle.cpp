@@ -0,0 +1,24 @@
+#include "SearchHandle.h"
+
+#include <chrono>
+
+using namespace std;
+
+SearchHandle::~SearchHandle() {
+    if (!waited_ && result_.valid()) {
+        ai_.StopSearch();
+        result_.wait();
+    }
+}
+
+bool SearchHandle::IsDone() const {
+    return waited_ || result_.wait_for(chrono::seconds(0)) == future_status::ready;
+}
+
+int SearchHandle::Wait() {
+    if (!waited_) {
+        waited_ = true;
+        pos_ = result_.get();
+    }
+    return pos_;
+}
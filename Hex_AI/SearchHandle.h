@@ -0,0 +1,45 @@
+#ifndef __Hex_AI__SearchHandle__
+#define __Hex_AI__SearchHandle__
+
+#include <future>
+
+#include "Ai.h"
+
+/*
+ * A search running in the background, see Ai::StartSearch.
+ * A front end can poll it, stop it when its deadline comes and take the best move
+ * found until then, or give it more time. Destroying the handle stops the search and
+ * waits for it to end.
+ */
+class SearchHandle {
+public:
+    SearchHandle(Ai& ai, std::future<int> result) :
+            ai_(ai), result_(std::move(result)) {
+    }
+    ~SearchHandle();
+    SearchHandle(const SearchHandle&) = delete;
+    SearchHandle& operator=(const SearchHandle&) = delete;
+
+    SearchProgress GetProgress() const {
+        return ai_.GetProgress();
+    }
+    bool IsDone() const;
+    //Ends the search as soon as possible, Wait returns the best move found.
+    void Stop() {
+        ai_.StopSearch();
+    }
+    //Gives the search more time, if it has a time limit.
+    void Extend(double seconds) {
+        ai_.ExtendSearch(seconds);
+    }
+    //Waits for the search to end and returns the position, or -1 if the AI gives up.
+    //Rethrows the exceptions of the search.
+    int Wait();
+private:
+    Ai& ai_;
+    std::future<int> result_;
+    bool waited_ = false;
+    int pos_ = -1;
+};
+
+#endif /* defined(__Hex_AI__SearchHandle__) */
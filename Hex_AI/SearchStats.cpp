@@ -0,0 +1,44 @@
+#include "SearchStats.h"
+
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+    double GetMilliseconds(double seconds) {
+        return static_cast<long long>(seconds * 1e6) / 1e3; //rounded to microseconds
+    }
+}
+
+string SearchStats::ToJson() const {
+    double prune_rate = candidates == 0 ? 0 : static_cast<double>(refuted_candidates) / candidates;
+    double utilization = playout_seconds <= 0 || threads == 0 ? 0 :
+            busy_seconds / (playout_seconds * threads);
+    ostringstream out;
+    out << "{\"move\":" << move
+            << ",\"board_size\":" << board_size
+            << ",\"free_positions\":" << free_positions
+            << ",\"candidates\":" << candidates
+            << ",\"refuted_candidates\":" << refuted_candidates
+            << ",\"prune_rate\":" << prune_rate
+            << ",\"responses\":" << responses
+            << ",\"dropped_responses\":" << dropped_responses
+            << ",\"cached_responses\":" << cached_responses
+            << ",\"previous_turn_responses\":" << previous_turn_responses
+            << ",\"playouts\":" << playouts
+            << ",\"wasted_playouts\":" << wasted_playouts
+            << ",\"sampling_gain\":" << sampling_gain
+            << ",\"network_evaluations\":" << network_evaluations
+            << ",\"out_of_time\":" << (out_of_time ? "true" : "false")
+            << ",\"stopped_early\":" << (stopped_early ? "true" : "false")
+            << ",\"selectable_ms\":" << GetMilliseconds(selectable_seconds)
+            << ",\"pruning_ms\":" << GetMilliseconds(pruning_seconds)
+            << ",\"ordering_ms\":" << GetMilliseconds(ordering_seconds)
+            << ",\"playout_ms\":" << GetMilliseconds(playout_seconds)
+            << ",\"total_ms\":" << GetMilliseconds(total_seconds)
+            << ",\"threads\":" << threads
+            << ",\"thread_utilization\":" << utilization
+            << "}";
+    return out.str();
+}
@@ -0,0 +1,76 @@
+#ifndef __Hex_AI__SearchStats__
+#define __Hex_AI__SearchStats__
+
+#include <chrono>
+#include <string>
+
+/*
+ * Counters and timers of the search of one AI move.
+ * The counters are always kept, they change a few times per response.
+ * The timers only run when the stats are written somewhere, see ScopedTimer.
+ */
+struct SearchStats {
+    int move = 0;
+    int board_size = 0;
+    int free_positions = 0;
+    int threads = 0;
+    //AI moves tested, and the ones that an opponent response refuted
+    int candidates = 0;
+    int refuted_candidates = 0;
+    //opponent responses simulated, and the ones dropped from the races
+    int responses = 0;
+    int dropped_responses = 0;
+    //responses that started from the cache, and the ones ordered by the previous turn
+    int cached_responses = 0;
+    int previous_turn_responses = 0;
+    //simulated games, and the ones run in a round that ended refuting its candidate
+    long long playouts = 0;
+    long long wasted_playouts = 0;
+    double sampling_gain = 1;
+    //positions evaluated by the network
+    long long network_evaluations = 0;
+    //the time budget ran out before the search ended
+    bool out_of_time = false;
+    //the search ended before its limits because the chosen move couldn't change
+    bool stopped_early = false;
+    //wall time of every part of the search
+    double selectable_seconds = 0;
+    double pruning_seconds = 0;
+    double ordering_seconds = 0;
+    double playout_seconds = 0;
+    double total_seconds = 0;
+    //time the threads of the pool spent running simulations
+    double busy_seconds = 0;
+
+    //Returns the stats as a JSON object in one line.
+    std::string ToJson() const;
+};
+
+/*
+ * Adds the time between its construction and destruction to a number of seconds,
+ * or does nothing if it gets a null pointer.
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(double* seconds) :
+            seconds_(seconds) {
+        if (seconds_ != nullptr) start_ = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+        Stop();
+    }
+    //Adds the time until now, the timer doesn't count after this.
+    void Stop() {
+        if (seconds_ != nullptr) {
+            *seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+            seconds_ = nullptr;
+        }
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+private:
+    double* seconds_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif /* defined(__Hex_AI__SearchStats__) */
@@ -0,0 +1,20 @@
+#include "SharedMemory.h"
+
+#include <stdexcept>
+#include <sys/mman.h>
+
+using namespace std;
+
+SharedMemory::SharedMemory(size_t size) :
+        data_(nullptr), size_(size) {
+    //anonymous mappings are always zeroed
+    void* data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        throw runtime_error("can't map " + to_string(size_) + " bytes of shared memory");
+    }
+    data_ = static_cast<char*>(data);
+}
+
+SharedMemory::~SharedMemory() {
+    munmap(data_, size_);
+}
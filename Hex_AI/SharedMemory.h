@@ -0,0 +1,29 @@
+#ifndef __Hex_AI__SharedMemory__
+#define __Hex_AI__SharedMemory__
+
+#include <cstddef>
+
+/*
+ * Zeroed memory that a process shares with the children that it forks after creating it.
+ * The memory is released when the object is destroyed.
+ * Throws std::runtime_error if it can't be mapped.
+ */
+class SharedMemory {
+public:
+    explicit SharedMemory(size_t size);
+    ~SharedMemory();
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    char* GetData() const {
+        return data_;
+    }
+    size_t GetSize() const {
+        return size_;
+    }
+private:
+    char* data_;
+    size_t size_;
+};
+
+#endif /* defined(__Hex_AI__SharedMemory__) */
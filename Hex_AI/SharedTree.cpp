@@ -0,0 +1,221 @@
+#include "SharedTree.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+#include "Trace.h"
+
+using namespace std;
+
+namespace {
+
+    //Weight of the exploration term of UCB1.
+    const double EXPLORATION = 1.0;
+
+    //Simulations lost for every thread inside a node, one descent.
+    const int VIRTUAL_LOSS = SharedTree::LEAF_SIMULATIONS;
+
+    //Simulations of the best move before the search can stop, its win ratio is
+    //still needed to know if the game is lost.
+    const int MIN_SETTLED_SIMULATIONS = 32 * SharedTree::LEAF_SIMULATIONS;
+
+    //Score of the nodes that were never simulated, chosen in their order.
+    const double UNVISITED_SCORE = 1e9;
+
+    //Weight of the probability of a node, it fades as the node gets simulations.
+    const double PRIOR_WEIGHT = 1.0;
+
+    //Returns the upper confidence bound of the node for the player that chooses it,
+    //with the threads inside it as lost simulations, plus the bias of its probability.
+    template<typename Node>
+    double GetScore(const Node& node, double log_parent, bool computer_chooses, double prior) {
+        int pending = node.pending.load(memory_order_relaxed);
+        double simulations = node.simulations.load(memory_order_relaxed) + pending * VIRTUAL_LOSS;
+        if (simulations == 0) {
+            return UNVISITED_SCORE;
+        }
+        double wins = node.wins.load(memory_order_relaxed);
+        //a loss for the opponent is a win for the computer
+        double ratio = computer_chooses ? wins / simulations : 1 - (wins + pending * VIRTUAL_LOSS) / simulations;
+        return ratio + EXPLORATION * sqrt(log_parent / simulations)
+                + PRIOR_WEIGHT * prior * SharedTree::LEAF_SIMULATIONS / simulations;
+    }
+
+    template<typename Node>
+    double GetLogVisits(const Node& node) {
+        double simulations = node.simulations.load(memory_order_relaxed)
+                + node.pending.load(memory_order_relaxed) * VIRTUAL_LOSS;
+        return log(max(simulations, 1.0));
+    }
+}
+
+SharedTree::SharedTree(const vector<int>& moves, int workers, Expander expander, const vector<double>& priors) :
+        moves_(moves.size()),
+        expander_(move(expander)),
+        new_results_(workers) {
+    for (size_t i = 0; i < moves.size(); i++) {
+        moves_[i].pos = moves[i];
+        moves_[i].prior = i < priors.size() ? priors[i] : 0;
+    }
+}
+
+SharedTree::~SharedTree() {
+    for (MoveNode& it : moves_) {
+        delete it.children.load();
+    }
+}
+
+void SharedTree::Search(int worker, long long max_simulations, uint64_t seed, const function<bool()>& stop) {
+    HEX_TRACE_SPAN("SharedTree::Search");
+    const atomic<bool> never(false);
+    vector<vector<SimulationTally>>& results = new_results_[worker];
+    results.resize(moves_.size());
+    for (long long descent = 0; simulations_.load(memory_order_relaxed) < max_simulations && !stop(); descent++) {
+        int index = SelectMove();
+        if (index < 0) {
+            this_thread::yield();
+            continue;
+        }
+        MoveNode& move = moves_[index];
+        Children* children = move.children.load(memory_order_acquire);
+        if (children == nullptr) {
+            bool expected = false;
+            if (!move.claimed.compare_exchange_strong(expected, true)) {
+                continue; //another thread got it first
+            }
+            children = Expand(move);
+        }
+        move.pending++;
+        int response = SelectResponse(move, *children);
+        Node& node = children->nodes[response];
+        node.pending++;
+
+        SimulationTally tally = children->expansion.simulators[response].Run(
+                LEAF_SIMULATIONS, never, MixSeed(seed, worker, descent));
+
+        node.simulations += tally.GetSimulations();
+        node.wins += tally.GetWins();
+        node.pending--;
+        move.simulations += tally.GetSimulations();
+        move.wins += tally.GetWins();
+        move.pending--;
+        simulations_ += tally.GetSimulations();
+        vector<SimulationTally>& move_results = results[index];
+        move_results.resize(children->expansion.responses.size());
+        move_results[response].Add(tally);
+    }
+}
+
+int SharedTree::SelectMove() const {
+    double log_parent = log(max(static_cast<double>(simulations_.load(memory_order_relaxed)), 1.0));
+    int best = -1;
+    double best_score = -1;
+    for (size_t i = 0; i < moves_.size(); i++) {
+        const MoveNode& move = moves_[i];
+        bool published = move.children.load(memory_order_acquire) != nullptr;
+        if (!published && move.claimed.load(memory_order_relaxed)) continue; //being expanded
+        double score = GetScore(move, log_parent, true, move.prior);
+        if (score > best_score) {
+            best_score = score;
+            best = static_cast<int>(i);
+        }
+    }
+    return best;
+}
+
+int SharedTree::SelectResponse(const MoveNode& move, const Children& children) const {
+    double log_parent = GetLogVisits(move);
+    int best = 0;
+    double best_score = -1;
+    const vector<double>& priors = children.expansion.priors;
+    int count = static_cast<int>(children.expansion.responses.size());
+    assert(count > 0);
+    for (int i = 0; i < count; i++) {
+        double prior = static_cast<size_t>(i) < priors.size() ? priors[i] : 0;
+        double score = GetScore(children.nodes[i], log_parent, false, prior);
+        if (score > best_score) {
+            best_score = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+//Builds the responses of a claimed move and publishes them with their known results.
+SharedTree::Children* SharedTree::Expand(MoveNode& move) {
+    HEX_TRACE_SPAN("SharedTree::Expand");
+    unique_ptr<Children> children(new Children());
+    expander_(move.pos, children->expansion);
+    const Expansion& expansion = children->expansion;
+    size_t count = expansion.responses.size();
+    children->nodes.reset(new Node[count]);
+    for (size_t i = 0; i < count && i < expansion.starts.size(); i++) {
+        const SimulationTally& start = expansion.starts[i];
+        children->nodes[i].simulations = start.GetSimulations();
+        children->nodes[i].wins = start.GetWins();
+        move.simulations += start.GetSimulations();
+        move.wins += start.GetWins();
+    }
+    Children* published = children.release();
+    move.children.store(published, memory_order_release);
+    return published;
+}
+
+double SharedTree::GetWinRatio(int index) const {
+    int simulations = moves_[index].simulations.load();
+    return simulations == 0 ? 0 : static_cast<double>(moves_[index].wins.load()) / simulations;
+}
+
+SimulationTally SharedTree::GetNewResults(int index, int response) const {
+    SimulationTally tally;
+    for (const vector<vector<SimulationTally>>& results : new_results_) {
+        if (static_cast<size_t>(index) < results.size()
+                && static_cast<size_t>(response) < results[index].size()) {
+            tally.Add(results[index][response]);
+        }
+    }
+    return tally;
+}
+
+bool SharedTree::IsSettled(long long remaining_simulations) const {
+    int best = GetBestMove();
+    if (best < 0) return false;
+    int best_simulations = moves_[best].simulations.load(memory_order_relaxed);
+    if (best_simulations < MIN_SETTLED_SIMULATIONS) return false;
+    int second_simulations = 0;
+    for (size_t i = 0; i < moves_.size(); i++) {
+        if (static_cast<int>(i) == best) continue;
+        second_simulations = max(second_simulations, moves_[i].simulations.load(memory_order_relaxed));
+    }
+    if (best_simulations - second_simulations > remaining_simulations) {
+        return true;
+    }
+    SimulationTally best_tally;
+    best_tally.AddIndependent(moves_[best].wins.load(memory_order_relaxed), best_simulations);
+    double lower_bound = best_tally.GetLowerBound();
+    for (size_t i = 0; i < moves_.size(); i++) {
+        if (static_cast<int>(i) == best) continue;
+        SimulationTally tally;
+        int simulations = moves_[i].simulations.load(memory_order_relaxed);
+        if (simulations > 0) {
+            tally.AddIndependent(moves_[i].wins.load(memory_order_relaxed), simulations);
+        }
+        if (tally.GetUpperBound() >= lower_bound) return false;
+    }
+    return true;
+}
+
+int SharedTree::GetBestMove() const {
+    int best = -1;
+    for (size_t i = 0; i < moves_.size(); i++) {
+        if (moves_[i].simulations.load() == 0) continue;
+        if (best < 0 || moves_[i].simulations.load() > moves_[best].simulations.load()
+                || (moves_[i].simulations.load() == moves_[best].simulations.load()
+                        && GetWinRatio(i) > GetWinRatio(best))) {
+            best = static_cast<int>(i);
+        }
+    }
+    return best;
+}
@@ -0,0 +1,120 @@
+#ifndef __Hex_AI__SharedTree__
+#define __Hex_AI__SharedTree__
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Simulation.h"
+#include "VirtualBoard.h"
+
+/*
+ * A search tree of the computer moves and the opponent responses that many threads
+ * descend at the same time without locks.
+ * Every descent chooses a move and then a response with UCB1, simulates the position
+ * a few times and adds the results to both nodes with atomic counters.
+ * While a thread is inside a node, the node counts a virtual loss for the player that
+ * chose it, so that the other threads spread to other lines.
+ * The responses of a move are made the first time it is chosen: one thread claims
+ * the move and builds them, and the others choose other moves until they are published.
+ */
+class SharedTree {
+public:
+    //The responses to a computer move and how they are simulated.
+    struct Expansion {
+        //the computer's board with the move, the simulators use it
+        std::unique_ptr<VirtualBoard> board;
+        //from the most to the least promising
+        std::vector<int> responses;
+        //probabilities of the responses for the opponent, empty without a network
+        std::vector<double> priors;
+        std::vector<Simulator> simulators;
+        //results known before the search, and the part of them that came from the cache
+        std::vector<SimulationTally> starts;
+        std::vector<SimulationTally> cached;
+    };
+    //Makes the expansion of a move, called from any thread.
+    typedef std::function<void(int pos, Expansion& expansion)> Expander;
+
+    //Simulations run in every descent.
+    static const int LEAF_SIMULATIONS = 32;
+
+    /*
+     * moves     The computer moves, from the most to the least promising
+     * workers   The threads that search the tree
+     * priors    Probabilities of the moves, if a network knows them. A node with a higher
+     *           probability is chosen more often until its simulations tell otherwise.
+     */
+    SharedTree(const std::vector<int>& moves, int workers, Expander expander,
+               const std::vector<double>& priors = std::vector<double>());
+    ~SharedTree();
+    SharedTree(const SharedTree&) = delete;
+    SharedTree& operator=(const SharedTree&) = delete;
+
+    //Descends the tree until stop returns true or the simulations reach the limit.
+    //Every thread calls it with its own worker number.
+    void Search(int worker, long long max_simulations, uint64_t seed, const std::function<bool()>& stop);
+
+    //The following are used once the search is over.
+    int GetMoveCount() const {
+        return static_cast<int>(moves_.size());
+    }
+    int GetMove(int index) const {
+        return moves_[index].pos;
+    }
+    //Returns null if the move was never chosen.
+    const Expansion* GetExpansion(int index) const {
+        Children* children = moves_[index].children.load();
+        return children == nullptr ? nullptr : &children->expansion;
+    }
+    //Returns the simulations of a move, counting the known results of its responses.
+    int GetSimulations(int index) const {
+        return moves_[index].simulations.load();
+    }
+    int GetWins(int index) const {
+        return moves_[index].wins.load();
+    }
+    double GetWinRatio(int index) const;
+    //Returns the simulations that the search ran for a response.
+    SimulationTally GetNewResults(int index, int response) const;
+    //Returns the index of the move with most simulations, or -1 if none was simulated.
+    int GetBestMove() const;
+    //Returns true if the best move can't change anymore: no other move can reach its
+    //simulations with the ones left, or the confidence intervals of the win ratios of
+    //the others are all below its own. Can be called during the search.
+    bool IsSettled(long long remaining_simulations) const;
+    long long GetTotalSimulations() const {
+        return simulations_.load(std::memory_order_relaxed);
+    }
+private:
+    struct Node {
+        std::atomic<int> simulations { 0 };
+        std::atomic<int> wins { 0 }; //of the computer
+        std::atomic<int> pending { 0 }; //threads inside the node
+    };
+    struct Children {
+        Expansion expansion;
+        std::unique_ptr<Node[]> nodes;
+    };
+    struct MoveNode: Node {
+        int pos = -1;
+        double prior = 0;
+        std::atomic<bool> claimed { false };
+        std::atomic<Children*> children { nullptr };
+    };
+
+    //Returns the index of the move to descend, or -1 if all of them are being expanded.
+    int SelectMove() const;
+    int SelectResponse(const MoveNode& move, const Children& children) const;
+    Children* Expand(MoveNode& move);
+
+    std::vector<MoveNode> moves_;
+    const Expander expander_;
+    std::atomic<long long> simulations_ { 0 };
+    //the results of every worker by move and response, only touched by their worker
+    std::vector<std::vector<std::vector<SimulationTally>>> new_results_;
+};
+
+#endif /* defined(__Hex_AI__SharedTree__) */
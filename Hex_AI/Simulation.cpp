@@ -0,0 +1,131 @@
+#include "Simulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "Trace.h"
+
+using namespace std;
+
+namespace {
+
+    //Normal quantile of the confidence intervals (99%).
+    const double CONFIDENCE_Z = 2.58;
+
+    //The estimated gain of the correlated fillings is capped,
+    //few blocks with the same result don't prove a zero variance.
+    const double MAX_SAMPLING_GAIN = 4;
+
+    //Returns the lower or upper bound of the Wilson score interval.
+    double GetWilsonBound(double ratio, double simulations, double sign) {
+        if (simulations <= 0) {
+            return sign < 0 ? 0 : 1;
+        }
+        double n = simulations;
+        double z2 = CONFIDENCE_Z * CONFIDENCE_Z;
+        double center = ratio + z2 / (2 * n);
+        double spread = CONFIDENCE_Z * sqrt(ratio * (1 - ratio) / n + z2 / (4 * n * n));
+        return (center + sign * spread) / (1 + z2 / n);
+    }
+
+    int CountBits(unsigned mask) {
+        int bits = 0;
+        for (; mask != 0; mask &= mask - 1) {
+            bits++;
+        }
+        return bits;
+    }
+}
+
+//The variance of the win ratio is the one of the block ratios divided by the blocks.
+//Independent simulations would have a variance of p(1 - p) / simulations.
+double SimulationTally::GetEffectiveSimulations() const {
+    double ratio = GetWinRatio();
+    double binomial_variance = ratio * (1 - ratio);
+    if (blocks_ < 2 || blocks_ == simulations_ || binomial_variance == 0) {
+        return simulations_;
+    }
+    double mean = block_ratios_ / blocks_;
+    double block_variance = (block_squares_ - blocks_ * mean * mean) / (blocks_ - 1);
+    double max_simulations = MAX_SAMPLING_GAIN * simulations_;
+    if (block_variance <= 0) {
+        return max_simulations;
+    }
+    return min(max_simulations, binomial_variance * blocks_ / block_variance);
+}
+
+double SimulationTally::GetLowerBound() const {
+    return GetWilsonBound(GetWinRatio(), GetEffectiveSimulations(), -1);
+}
+
+double SimulationTally::GetUpperBound() const {
+    return GetWilsonBound(GetWinRatio(), GetEffectiveSimulations(), 1);
+}
+
+int Simulator::GetBlockSize() const {
+    switch (mode_) {
+    case SamplingMode::ANTITHETIC:
+        return 2;
+    case SamplingMode::STRATIFIED:
+        return STRATA;
+    default:
+        return 1;
+    }
+}
+
+void Simulator::MakeFills(const vector<int>& shuffled_nodes, vector<unsigned char>& fills) const {
+    const int free_count = static_cast<int>(shuffled_nodes.size());
+    if (mode_ != SamplingMode::STRATIFIED) {
+        //the first filling takes the first positions and the second one the last ones
+        for (int i = 0; i < GetBlockSize(); i++) {
+            int start = i == 0 ? 0 : free_count - pos_to_fill_;
+            for (int j = start; j < start + pos_to_fill_; j++) {
+                fills[shuffled_nodes[j]] |= 1 << i;
+            }
+        }
+        return;
+    }
+    //rows of the Sylvester Hadamard matrix of size STRATA with half of the slices
+    const int rows[STRATA / 2] = { 1, 2, 4, 7 };
+    for (int i = 0; i < STRATA; i++) {
+        int row = rows[i / 2];
+        bool complement = i % 2 == 1;
+        //positions of the own slices first and then the rest, until enough are filled
+        int filled = 0;
+        for (int pass = 0; pass < 2 && filled < pos_to_fill_; pass++) {
+            for (int slice = 0; slice < STRATA && filled < pos_to_fill_; slice++) {
+                bool owned = (CountBits(row & slice) % 2 == 0) != complement;
+                if (owned == (pass == 1)) continue;
+                int end = (slice + 1) * free_count / STRATA;
+                for (int j = slice * free_count / STRATA; j < end && filled < pos_to_fill_; j++) {
+                    fills[shuffled_nodes[j]] |= 1 << i;
+                    filled++;
+                }
+            }
+        }
+    }
+}
+
+SimulationTally Simulator::Run(int simulations, const atomic<bool>& abort, uint64_t seed) const {
+    HEX_TRACE_COUNTED_SPAN("Simulator::Run");
+    seed_seq seeds { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) };
+    default_random_engine engine(seeds);
+    vector<int> free_nodes = free_nodes_;
+    const int block_size = GetBlockSize();
+    //the stones already on the board are in every filling bit, even the unused ones
+    const unsigned block_fills = (1u << block_size) - 1;
+    vector<unsigned char> fills(board_.GetSize() * board_.GetSize());
+    SimulationTally tally;
+    while (tally.GetSimulations() < simulations && !abort) {
+        shuffle(free_nodes.begin(), free_nodes.end(), engine); //shuffle free positions
+        MakeFills(free_nodes, fills);
+        //the board is preinitialized with already occupied positions in the real board
+        //plus one position occupied by AI in the top level of the simulation
+        tally.AddBlock(CountBits(board_.GetWinningFills(fills) & block_fills), block_size);
+        for (int pos : free_nodes) {
+            fills[pos] = 0;
+        }
+    }
+    return tally;
+}
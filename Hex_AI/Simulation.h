@@ -0,0 +1,156 @@
+#ifndef __Hex_AI__Simulation__
+#define __Hex_AI__Simulation__
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "VirtualBoard.h"
+
+/*
+ * How the random fillings of the board are drawn.
+ * INDEPENDENT  Every filling is shuffled on its own.
+ * ANTITHETIC   Fillings come in pairs, the second one gives the AI the positions that
+ *              the first one gave to the opponent. Both are as likely as independent
+ *              ones, but their results are negatively correlated.
+ * STRATIFIED   Fillings come in groups of STRATA from one shuffle cut in STRATA slices.
+ *              Each filling gives the AI half of the slices following the rows of a
+ *              Hadamard matrix, and the next filling gives it the other half.
+ *              Every free position goes to the AI in half of the group, and any two
+ *              fillings that are not complementary share half of their slices.
+ */
+enum class SamplingMode {
+    INDEPENDENT, ANTITHETIC, STRATIFIED
+};
+
+//Mixes a seed with the numbers of a simulation task, so that every task draws
+//different fillings (SplitMix64 finalizer).
+inline uint64_t MixSeed(uint64_t seed, uint64_t first, uint64_t second) {
+    uint64_t z = seed + 0x9e3779b97f4a7c15ULL * (first * 0x10001ULL + second + 1);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * Counts the simulated games won by the computer.
+ * Simulations are added in blocks of correlated fillings, so that the variance
+ * of the win ratio and the equivalent amount of independent simulations
+ * (effective sample size) can be estimated.
+ */
+class SimulationTally {
+public:
+    //The numbers that make a tally, to keep it outside of the program.
+    struct Counters {
+        int32_t wins;
+        int32_t simulations;
+        int32_t blocks;
+        double block_ratios;
+        double block_squares;
+    };
+
+    SimulationTally() = default;
+    explicit SimulationTally(const Counters& counters) :
+            wins_(counters.wins),
+            simulations_(counters.simulations),
+            blocks_(counters.blocks),
+            block_ratios_(counters.block_ratios),
+            block_squares_(counters.block_squares) {
+    }
+    Counters GetCounters() const {
+        return Counters { wins_, simulations_, blocks_, block_ratios_, block_squares_ };
+    }
+
+    void AddResult(bool won) {
+        AddBlock(won ? 1 : 0, 1);
+    }
+    void AddBlock(int wins, int simulations) {
+        double ratio = static_cast<double>(wins) / simulations;
+        wins_ += wins;
+        simulations_ += simulations;
+        blocks_++;
+        block_ratios_ += ratio;
+        block_squares_ += ratio * ratio;
+    }
+    //Adds results as if they came from independent simulations.
+    void AddIndependent(int wins, int simulations) {
+        wins_ += wins;
+        simulations_ += simulations;
+        blocks_ += simulations;
+        block_ratios_ += wins;
+        block_squares_ += wins;
+    }
+    void Add(const SimulationTally& other) {
+        wins_ += other.wins_;
+        simulations_ += other.simulations_;
+        blocks_ += other.blocks_;
+        block_ratios_ += other.block_ratios_;
+        block_squares_ += other.block_squares_;
+    }
+    int GetWins() const {
+        return wins_;
+    }
+    int GetSimulations() const {
+        return simulations_;
+    }
+    double GetWinRatio() const {
+        return simulations_ == 0 ? 0 : static_cast<double>(wins_) / simulations_;
+    }
+    //Amount of independent simulations that would give the same variance.
+    double GetEffectiveSimulations() const;
+    //Bounds of the Wilson score interval of the win ratio, using the effective simulations.
+    //Without simulations the interval is [0, 1].
+    double GetLowerBound() const;
+    double GetUpperBound() const;
+private:
+    int wins_ = 0;
+    int simulations_ = 0;
+    int blocks_ = 0;
+    double block_ratios_ = 0;
+    double block_squares_ = 0;
+};
+
+/*
+ * Runs Monte Carlo simulations of the games that follow an opponent response.
+ * Every simulation fills at random part of the free positions with the computer's
+ * stones and checks if it connected its edges.
+ * All the fillings of a block are checked together with one flood fill.
+ * It is run from multiple threads, so it doesn't change after construction.
+ */
+class Simulator {
+public:
+    //Fillings in a block of the STRATIFIED mode.
+    static const int STRATA = 8;
+
+    /*
+     * free_nodes   The free positions after the opponent's response
+     * board        The board initialized with the computer's occupied positions
+     * pos_to_fill  The amount of free positions that the computer occupies
+     * mode         How the fillings are drawn
+     */
+    Simulator(std::vector<int> free_nodes,
+              const VirtualBoard& board,
+              int pos_to_fill,
+              SamplingMode mode = SamplingMode::INDEPENDENT) :
+            free_nodes_(std::move(free_nodes)),
+            board_(board),
+            pos_to_fill_(pos_to_fill),
+            mode_(mode) {
+    }
+
+    //Runs at least the given amount of simulations, rounded up to whole blocks.
+    //They stop early if abort becomes true. The same seed gives the same fillings.
+    SimulationTally Run(int simulations, const std::atomic<bool>& abort, uint64_t seed) const;
+private:
+    int GetBlockSize() const;
+    //Marks in fills the positions that the AI occupies in every filling of a block.
+    void MakeFills(const std::vector<int>& shuffled_nodes, std::vector<unsigned char>& fills) const;
+
+    const std::vector<int> free_nodes_;
+    const VirtualBoard& board_;
+    const int pos_to_fill_;
+    const SamplingMode mode_;
+};
+
+#endif /* defined(__Hex_AI__Simulation__) */
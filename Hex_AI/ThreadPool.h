@@ -11,6 +11,8 @@
 #include <functional>
 #include <stdexcept>
 
+#include "Trace.h"
+
 class ThreadPool {
 public:
     ThreadPool(size_t);
@@ -39,13 +41,17 @@ inline ThreadPool::ThreadPool(size_t threads) :
             for(;;)
             {
                 std::unique_lock<std::mutex> lock(this->queue_mutex);
-                while(!this->stop && this->tasks.empty())
-                this->condition.wait(lock);
+                {
+                    HEX_TRACE_SPAN("ThreadPool wait");
+                    while(!this->stop && this->tasks.empty())
+                    this->condition.wait(lock);
+                }
                 if(this->stop && this->tasks.empty())
                 return;
                 std::function<void()> task(this->tasks.front());
                 this->tasks.pop();
                 lock.unlock();
+                HEX_TRACE_SPAN("ThreadPool task");
                 task();
             }
         });
@@ -69,6 +75,7 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
         std::unique_lock<std::mutex> lock(queue_mutex);
         tasks.push([task]() {(*task)();});
     }
+    HEX_TRACE_INSTANT("ThreadPool enqueue");
     condition.notify_one();
     return res;
 }
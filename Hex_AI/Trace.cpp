@@ -0,0 +1,168 @@
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#if HEX_TRACING >= 2 && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+    struct Event {
+        const char* name;
+        char phase; //'X' for spans and 'i' for instant events
+        int thread;
+        long long start;
+        long long duration;
+        Trace::Counters counters;
+    };
+
+    atomic<bool> recording(false);
+    mutex events_mutex;
+    vector<Event> events;
+    string trace_path;
+    chrono::steady_clock::time_point start_time;
+
+    //Small numbers for the threads, in the order they record their first event.
+    int GetThreadNumber() {
+        static atomic<int> threads(0);
+        thread_local int number = threads++;
+        return number;
+    }
+
+    void AddEvent(const Event& event) {
+        lock_guard<mutex> lock(events_mutex);
+        if (recording) events.push_back(event);
+    }
+
+#if HEX_TRACING >= 2 && defined(__linux__)
+    //Counters of a thread in one perf event group, opened the first time they are read.
+    class PerfCounters {
+    public:
+        PerfCounters() {
+            leader_ = Open(PERF_COUNT_HW_CPU_CYCLES, -1);
+            if (leader_ < 0) return;
+            if (Open(PERF_COUNT_HW_CACHE_MISSES, leader_) < 0
+                    || Open(PERF_COUNT_HW_BRANCH_MISSES, leader_) < 0) {
+                Close();
+                return;
+            }
+            ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+        ~PerfCounters() {
+            Close();
+        }
+        Trace::Counters Read() const {
+            Trace::Counters counters;
+            //amount of counters followed by their values
+            uint64_t values[4];
+            if (leader_ >= 0 && read(leader_, values, sizeof(values)) == sizeof(values)) {
+                counters.cycles = values[1];
+                counters.cache_misses = values[2];
+                counters.branch_misses = values[3];
+                counters.valid = true;
+            }
+            return counters;
+        }
+    private:
+        int Open(uint64_t config, int group) {
+            perf_event_attr attr = perf_event_attr();
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = config;
+            attr.disabled = group < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            //this thread on any cpu
+            int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+            if (fd >= 0) fds_.push_back(fd);
+            return fd;
+        }
+        void Close() {
+            for (int fd : fds_) {
+                close(fd);
+            }
+            fds_.clear();
+            leader_ = -1;
+        }
+
+        int leader_ = -1;
+        vector<int> fds_;
+    };
+#endif
+}
+
+void Trace::Start(const string& path) {
+    lock_guard<mutex> lock(events_mutex);
+    events.clear();
+    trace_path = path;
+    start_time = chrono::steady_clock::now();
+    recording = true;
+}
+
+void Trace::Stop() {
+    lock_guard<mutex> lock(events_mutex);
+    if (!recording) return;
+    recording = false;
+    ofstream out(trace_path);
+    out << "{\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); i++) {
+        const Event& event = events[i];
+        out << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << event.name
+                << "\",\"ph\":\"" << event.phase
+                << "\",\"pid\":1,\"tid\":" << event.thread
+                << ",\"ts\":" << event.start;
+        if (event.phase == 'X') {
+            out << ",\"dur\":" << event.duration;
+        } else {
+            out << ",\"s\":\"t\"";
+        }
+        if (event.counters.valid) {
+            out << ",\"args\":{\"cycles\":" << event.counters.cycles
+                    << ",\"cache_misses\":" << event.counters.cache_misses
+                    << ",\"branch_misses\":" << event.counters.branch_misses << "}";
+        }
+        out << "}";
+    }
+    out << "\n]}\n";
+    events.clear();
+}
+
+bool Trace::IsRecording() {
+    return recording.load(memory_order_relaxed);
+}
+
+long long Trace::GetTime() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start_time).count();
+}
+
+Trace::Counters Trace::ReadCounters() {
+#if HEX_TRACING >= 2 && defined(__linux__)
+    thread_local PerfCounters counters;
+    return counters.Read();
+#else
+    return Counters();
+#endif
+}
+
+void Trace::RecordSpan(const char* name, long long start, long long duration, const Counters* counters) {
+    Event event { name, 'X', GetThreadNumber(), start, duration, Counters() };
+    if (counters != nullptr) event.counters = *counters;
+    AddEvent(event);
+}
+
+void Trace::RecordInstant(const char* name) {
+    if (!IsRecording()) return;
+    AddEvent(Event { name, 'i', GetThreadNumber(), GetTime(), 0, Counters() });
+}
@@ -0,0 +1,97 @@
+#ifndef __Hex_AI__Trace__
+#define __Hex_AI__Trace__
+
+#include <cstdint>
+#include <string>
+
+/*
+ * Tracing of the search in the Chrome trace event format (chrome://tracing or Perfetto).
+ * HEX_TRACING chooses what is compiled:
+ *   0  nothing, the spans are empty objects that the compiler removes (default)
+ *   1  timed spans and instant events
+ *   2  also the cycles, cache misses and branch misses of the counted spans,
+ *      read with perf_event_open on Linux
+ * The events are only recorded between Trace::Start and Trace::Stop.
+ */
+#ifndef HEX_TRACING
+#define HEX_TRACING 0
+#endif
+
+namespace Trace {
+
+    //Hardware counters of the calling thread.
+    struct Counters {
+        uint64_t cycles = 0;
+        uint64_t cache_misses = 0;
+        uint64_t branch_misses = 0;
+        bool valid = false;
+    };
+
+    //Starts recording the events that will be written to the file.
+    void Start(const std::string& path);
+    //Writes the recorded events and stops recording.
+    void Stop();
+    bool IsRecording();
+    //Microseconds since the recording started.
+    long long GetTime();
+    //Returns the counters of the calling thread, not valid if they can't be read.
+    Counters ReadCounters();
+    //Records a span that started at start and took duration, with the difference
+    //of the counters in it if they are given.
+    void RecordSpan(const char* name, long long start, long long duration, const Counters* counters);
+    void RecordInstant(const char* name);
+
+    /*
+     * Records its lifetime as a span. ENABLED and COUNTERS come from HEX_TRACING
+     * through the macros below.
+     */
+    template<bool ENABLED, bool COUNTERS>
+    class Span {
+    public:
+        explicit Span(const char* name) :
+                name_(name), start_(IsRecording() ? GetTime() : -1) {
+            if (COUNTERS && start_ >= 0) counters_ = ReadCounters();
+        }
+        ~Span() {
+            if (start_ < 0) return;
+            if (COUNTERS && counters_.valid) {
+                Counters end = ReadCounters();
+                end.cycles -= counters_.cycles;
+                end.cache_misses -= counters_.cache_misses;
+                end.branch_misses -= counters_.branch_misses;
+                RecordSpan(name_, start_, GetTime() - start_, &end);
+            } else {
+                RecordSpan(name_, start_, GetTime() - start_, nullptr);
+            }
+        }
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+    private:
+        const char* name_;
+        long long start_;
+        Counters counters_;
+    };
+
+    template<bool COUNTERS>
+    class Span<false, COUNTERS> {
+    public:
+        explicit Span(const char*) {
+        }
+    };
+}
+
+#define HEX_TRACE_JOIN(a, b) a##b
+#define HEX_TRACE_NAME(line) HEX_TRACE_JOIN(trace_span_, line)
+//Traces the rest of the scope.
+#define HEX_TRACE_SPAN(name) \
+    Trace::Span<(HEX_TRACING >= 1), false> HEX_TRACE_NAME(__LINE__)(name)
+//Traces the rest of the scope with the hardware counters.
+#define HEX_TRACE_COUNTED_SPAN(name) \
+    Trace::Span<(HEX_TRACING >= 1), (HEX_TRACING >= 2)> HEX_TRACE_NAME(__LINE__)(name)
+#if HEX_TRACING >= 1
+#define HEX_TRACE_INSTANT(name) Trace::RecordInstant(name)
+#else
+#define HEX_TRACE_INSTANT(name) ((void) 0)
+#endif
+
+#endif /* defined(__Hex_AI__Trace__) */
@@ -0,0 +1,84 @@
+#ifndef __Hex_AI__VertexSet__
+#define __Hex_AI__VertexSet__
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * A set of the vertices of a graph, one bit per vertex in 64 bit words,
+ * so that whole words of vertices can be tested and combined at once.
+ */
+class VertexSet {
+public:
+    static const int WORD_BITS = 64;
+
+    explicit VertexSet(int size) :
+            size_(size), words_((size + WORD_BITS - 1) / WORD_BITS) {
+    }
+
+    int GetSize() const {
+        return size_;
+    }
+    bool Test(int x) const {
+        return (words_[x / WORD_BITS] >> (x % WORD_BITS)) & 1;
+    }
+    void Set(int x) {
+        words_[x / WORD_BITS] |= uint64_t(1) << (x % WORD_BITS);
+    }
+    void Reset(int x) {
+        words_[x / WORD_BITS] &= ~(uint64_t(1) << (x % WORD_BITS));
+    }
+    void Clear() {
+        words_.assign(words_.size(), 0);
+    }
+    //Returns the number of vertices in the set.
+    int Count() const {
+        int count = 0;
+        for (uint64_t word : words_) {
+            count += __builtin_popcountll(word);
+        }
+        return count;
+    }
+    bool IsEmpty() const {
+        for (uint64_t word : words_) {
+            if (word != 0) return false;
+        }
+        return true;
+    }
+    //Calls apply(x) for every vertex in the set, in increasing order.
+    template<typename Apply>
+    void ForEach(Apply apply) const {
+        for (int i = 0; i < static_cast<int>(words_.size()); i++) {
+            for (uint64_t word = words_[i]; word != 0; word &= word - 1) {
+                apply(i * WORD_BITS + __builtin_ctzll(word));
+            }
+        }
+    }
+    //Calls apply(x) for every vertex that is not in the set, in increasing order.
+    template<typename Apply>
+    void ForEachMissing(Apply apply) const {
+        for (int i = 0; i < static_cast<int>(words_.size()); i++) {
+            uint64_t word = ~words_[i];
+            if (i == static_cast<int>(words_.size()) - 1 && size_ % WORD_BITS != 0) {
+                word &= (uint64_t(1) << (size_ % WORD_BITS)) - 1; //no vertices after the last one
+            }
+            for (; word != 0; word &= word - 1) {
+                apply(i * WORD_BITS + __builtin_ctzll(word));
+            }
+        }
+    }
+    VertexSet& operator|=(const VertexSet& other) {
+        for (size_t i = 0; i < words_.size(); i++) {
+            words_[i] |= other.words_[i];
+        }
+        return *this;
+    }
+    bool operator==(const VertexSet& other) const {
+        return size_ == other.size_ && words_ == other.words_;
+    }
+private:
+    int size_;
+    std::vector<uint64_t> words_;
+};
+
+#endif /* defined(__Hex_AI__VertexSet__) */
@@ -28,3 +28,4 @@ void VirtualBoard::FillBoard(const std::vector<int> &free_nodes, int to_fill) {
         Occupy(free_nodes[i]);
     }
 }
+
@@ -4,16 +4,18 @@
 #include <vector>
 
 #include "AbstractBoard.h"
-#include "Graph.h"
+#include "DisjointSets.h"
+#include "Playout.h"
 
 /*
  * More efficient implementation of AbstractBoard to create and destroy
  * multiple times during the Monte Carlo simulations.
  * It manages the occupied positions by only one player (the AI).
- * It stores which positions the AI has connected in a graph with two extra
+ * It stores which positions the AI has connected in disjoint sets with two extra
  * nodes that represent the two edges of the board that it has to connect.
+ * Its memory grows linearly with the positions, so it is cheap to copy.
  */
-class VirtualBoard: public AbstractBoard {
+class VirtualBoard: public BoardCore<VirtualBoard> {
 public:
     //We only set AI stones in the virtual board, so the player number is irrelevant.
     static const Player VIRTUAL_PLAYER; // = BLUE_PLAYER
@@ -22,36 +24,52 @@ public:
      * connect_letters  True if the AI needs to connect letters to win
      */
     VirtualBoard(int size, bool connect_letters) :
-            //2 extra vertices in the graph for virtual nodes
-            AbstractBoard(size), graph_(size * size + 2) {
+            //2 extra vertices in the sets for virtual nodes
+            BoardCore(size),
+            connect_letters_(connect_letters),
+            winning_fills_(Playout::GetWinningFillsFunction(size)),
+            groups_(size * size + 2) {
         MakeVirtualNodes(connect_letters);
     }
 
     void FillBoard(const std::vector<int> &shuffled_free_nodes, int);
+    /*
+     * Checks up to 8 fillings of the board with a single flood fill.
+     * Bit i of fills[pos] is set if the AI occupies the free position in the filling i.
+     * Returns a mask with bit i set if the AI connects its edges in the filling i.
+     * The board itself is not changed.
+     */
+    unsigned GetWinningFills(const std::vector<unsigned char>& fills) const {
+        return winning_fills_(*this, fills, connect_letters_);
+    }
     void Occupy(int pos) {
         OccupyImpl(pos, VIRTUAL_PLAYER);
     }
     bool HasWon() {
-        return AbstractBoard::HasWon(VIRTUAL_PLAYER);
+        return BoardCore::HasWon(VIRTUAL_PLAYER);
     }
 private:
+    friend class BoardCore<VirtualBoard>;
     void MakeVirtualNodes(bool connect_letters);
-    void OccupyImpl(int pos, const Player& player) override {
+    void OccupyImpl(int pos, const Player& player) {
         SetStone(pos, player);
     }
-    void MarkConnected(int pos1, int pos2, const Player& player) override {
+    void MarkConnected(int pos1, int pos2, const Player&) {
         MarkConnected(pos1, pos2);
     }
     void MarkConnected(int pos1, int pos2) {
         assert(pos1 >= 0 && pos2 >= 0);
-        graph_.AddEdge(pos1, pos2);
+        groups_.Join(pos1, pos2);
     }
-    bool AreConnected(int pos1, int pos2, const Player& player) const override {
+    bool AreConnected(int pos1, int pos2, const Player&) const {
         assert(pos1 >= 0 && pos2 >= 0);
-        return graph_.AreAdjacent(pos1, pos2);
+        return groups_.AreJoined(pos1, pos2);
     }
 
+    bool connect_letters_;
+    //flood fill compiled for the size of this board
+    Playout::WinningFillsFunction winning_fills_;
     //Stores which positions the computer has connected
-    Graph<int> graph_;
+    DisjointSets groups_;
 };
 #endif /* defined(__Hex_AI__VirtualBoard__) */
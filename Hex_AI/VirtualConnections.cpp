@@ -0,0 +1,253 @@
+#include "VirtualConnections.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "AbstractBoard.h"
+
+using namespace std;
+
+namespace {
+
+    //Limits of stored connections per pair of points.
+    const size_t MAX_FULL = 6;
+    const size_t MAX_SEMI = 12;
+
+    //Maximum rule applications in a search.
+    const int MAX_WORK = 400000;
+
+    //Returns true if the carrier contains any of the stored carriers.
+    bool IsDominated(const vector<CellSet>& stored, const CellSet& carrier) {
+        for (const CellSet& it : stored) {
+            if ((it & ~carrier).none()) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+VirtualConnections::VirtualConnections(const AbstractBoard& board, const Player& player) :
+        size_(board.GetSize()),
+        player_(player),
+        point_of_pos_(size_ * size_, -1),
+        first_edge_(0),
+        second_edge_(1),
+        work_left_(MAX_WORK) {
+    assert(size_ <= HexConst::MAX_BOARD_SIZE);
+    MakePoints(board);
+    partners_.resize(pos_of_point_.size());
+    MakeAdjacentConnections();
+    Search();
+}
+
+//Groups the stones of the player that are connected, including the ones
+//touching the edges, and gives a point to every free position.
+void VirtualConnections::MakePoints(const AbstractBoard& board) {
+    pos_of_point_.assign(2, -1); //the two edges
+    int total_pos = size_ * size_;
+    for (int pos = 0; pos < total_pos; pos++) {
+        if (!board.Belongs(pos, player_) || point_of_pos_[pos] >= 0) continue;
+        //find the whole group with a depth first search
+        vector<int> group;
+        vector<int> stack(1, pos);
+        point_of_pos_[pos] = -2; //visited
+        int touched = 0; //bit 1 for the first edge and bit 2 for the second
+        while (!stack.empty()) {
+            int current = stack.back();
+            stack.pop_back();
+            group.push_back(current);
+            int edge = GetTouchedEdge(current);
+            if (edge != 0) touched |= edge;
+            ApplyAroundPosition(current, &player_, size_, [&](int, int y, const Player*) {
+                point_of_pos_[y] = -2;
+                stack.push_back(y);
+            }, [&](int x, const Player* p) {
+                return point_of_pos_[x] == -1 && board.Belongs(x, *p);
+            });
+        }
+        int point;
+        if (touched == 3) {
+            //the edges are already connected
+            point = second_edge_ = first_edge_;
+        } else if (touched != 0) {
+            point = touched == 1 ? first_edge_ : second_edge_;
+        } else {
+            point = static_cast<int>(pos_of_point_.size());
+            pos_of_point_.push_back(-1);
+        }
+        for (int it : group) {
+            point_of_pos_[it] = point;
+        }
+    }
+    for (int pos = 0; pos < total_pos; pos++) {
+        if (!board.IsOccupied(pos)) {
+            point_of_pos_[pos] = static_cast<int>(pos_of_point_.size());
+            pos_of_point_.push_back(pos);
+        }
+    }
+}
+
+//Adjacent points are connected with an empty carrier.
+void VirtualConnections::MakeAdjacentConnections() {
+    CellSet empty;
+    int total_pos = size_ * size_;
+    for (int pos = 0; pos < total_pos; pos++) {
+        int point = point_of_pos_[pos];
+        if (point < 0 || pos_of_point_[point] < 0) continue; //only free positions
+        ApplyAroundPosition(pos, &player_, size_, [&](int, int y, const Player*) {
+            AddFull(point, point_of_pos_[y], empty);
+        }, [&](int x, const Player*) {
+            return point_of_pos_[x] >= 0;
+        });
+        int edge = GetTouchedEdge(pos);
+        if (edge != 0) {
+            AddFull(point, edge == 1 ? first_edge_ : second_edge_, empty);
+        }
+    }
+}
+
+//Combines every new full connection with the stored ones until nothing new is found.
+void VirtualConnections::Search() {
+    while (!pending_.empty() && work_left_ > 0) {
+        NewConnection added = pending_.front();
+        pending_.pop_front();
+        //x-y followed by y-w
+        vector<int> partners = partners_[added.y];
+        for (int w : partners) {
+            vector<CellSet> carriers = Find(added.y, w)->full;
+            for (const CellSet& it : carriers) {
+                ApplyAndRule(added.x, added.y, w, added.carrier, it);
+            }
+        }
+        //w-x followed by x-y
+        partners = partners_[added.x];
+        for (int w : partners) {
+            vector<CellSet> carriers = Find(w, added.x)->full;
+            for (const CellSet& it : carriers) {
+                ApplyAndRule(w, added.x, added.y, it, added.carrier);
+            }
+        }
+    }
+}
+
+void VirtualConnections::ApplyAndRule(int x, int z, int y,
+                                      const CellSet& first,
+                                      const CellSet& second) {
+    work_left_--;
+    if (x == y) return;
+    if ((first & second).any()) return;
+    if ((first & GetPointCells(y)).any() || (second & GetPointCells(x)).any()) return;
+    CellSet carrier = first | second;
+    if (pos_of_point_[z] < 0) {
+        AddFull(x, y, carrier);
+    } else {
+        carrier.set(pos_of_point_[z]);
+        AddSemi(x, y, carrier);
+    }
+}
+
+void VirtualConnections::ApplyOrRule(int x, int y, const CellSet& semi) {
+    vector<CellSet> others = connections_[GetKey(x, y)].semi;
+    CellSet all_union = semi;
+    CellSet all_intersection = semi;
+    for (const CellSet& it : others) {
+        if (it == semi) continue;
+        if ((it & semi).none()) {
+            AddFull(x, y, it | semi);
+        }
+        all_union |= it;
+        all_intersection &= it;
+        if (all_intersection.none()) {
+            AddFull(x, y, all_union);
+            break;
+        }
+    }
+}
+
+bool VirtualConnections::AddFull(int x, int y, const CellSet& carrier) {
+    if (x == y) return false;
+    Connections& stored = connections_[GetKey(x, y)];
+    if (stored.full.size() >= MAX_FULL || IsDominated(stored.full, carrier)) {
+        return false;
+    }
+    if (stored.full.empty()) {
+        partners_[x].push_back(y);
+        partners_[y].push_back(x);
+    }
+    stored.full.push_back(carrier);
+    pending_.push_back(NewConnection { x, y, carrier });
+    return true;
+}
+
+bool VirtualConnections::AddSemi(int x, int y, const CellSet& carrier) {
+    Connections& stored = connections_[GetKey(x, y)];
+    if (stored.semi.size() >= MAX_SEMI || IsDominated(stored.full, carrier)
+            || IsDominated(stored.semi, carrier)) {
+        return false;
+    }
+    stored.semi.push_back(carrier);
+    ApplyOrRule(x, y, carrier);
+    return true;
+}
+
+int VirtualConnections::GetTouchedEdge(int pos) const {
+    //the first player connects the rows and the second one the columns
+    int line = player_.PlaysFirst() ? pos / size_ : pos % size_;
+    if (line == 0) return 1;
+    if (line == size_ - 1) return 2;
+    return 0;
+}
+
+CellSet VirtualConnections::GetPointCells(int point) const {
+    CellSet cells;
+    if (pos_of_point_[point] >= 0) {
+        cells.set(pos_of_point_[point]);
+    }
+    return cells;
+}
+
+long long VirtualConnections::GetKey(int x, int y) const {
+    if (x > y) swap(x, y);
+    return static_cast<long long>(x) * pos_of_point_.size() + y;
+}
+
+const VirtualConnections::Connections* VirtualConnections::Find(int x, int y) const {
+    auto it = connections_.find(GetKey(x, y));
+    return it == connections_.end() ? nullptr : &it->second;
+}
+
+bool VirtualConnections::HasWinningConnection() const {
+    if (first_edge_ == second_edge_) return true;
+    const Connections* edges = Find(first_edge_, second_edge_);
+    return edges != nullptr && !edges->full.empty();
+}
+
+bool VirtualConnections::HasWinningThreat() const {
+    if (HasWinningConnection()) return true;
+    const Connections* edges = Find(first_edge_, second_edge_);
+    return edges != nullptr && !edges->semi.empty();
+}
+
+//The opponent has to play in every carrier of the semi connections between the edges,
+//so it has to play in their intersection.
+//Only some of the semi connections are stored, so the result might be bigger than needed.
+unordered_set<int> VirtualConnections::GetMustPlay() const {
+    unordered_set<int> must_play;
+    if (HasWinningConnection() || !HasWinningThreat()) {
+        return must_play;
+    }
+    const Connections* edges = Find(first_edge_, second_edge_);
+    CellSet intersection;
+    intersection.set();
+    for (const CellSet& it : edges->semi) {
+        intersection &= it;
+    }
+    int total_pos = size_ * size_;
+    for (int pos = 0; pos < total_pos; pos++) {
+        if (intersection.test(pos)) {
+            must_play.insert(pos);
+        }
+    }
+    return must_play;
+}
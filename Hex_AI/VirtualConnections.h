@@ -0,0 +1,85 @@
+#ifndef __Hex_AI__VirtualConnections__
+#define __Hex_AI__VirtualConnections__
+
+#include <bitset>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "HexConst.h"
+#include "Player.h"
+
+class AbstractBoard;
+
+//A set of board positions, used for the carriers of the connections.
+typedef std::bitset<HexConst::MAX_POSITIONS> CellSet;
+
+/*
+ * Finds the virtual connections of a player with H-search.
+ * A full connection between two points means that the player can connect them
+ * even if the opponent moves first, using only the free positions in its carrier.
+ * A semi connection needs the player to move first in its carrier.
+ * The points are the free positions, the groups of connected stones of the player
+ * and the two board edges that the player has to connect.
+ *
+ * Connections start from adjacent points and are combined with two rules:
+ * AND: x-z and z-y with disjoint carriers make a full connection x-y if z is
+ *      a group, or a semi connection with z in the carrier if z is free.
+ * OR:  semi connections x-y with no position in common make a full connection.
+ * Bridges and edge templates come out of these rules.
+ */
+class VirtualConnections {
+public:
+    //Runs the search for the player on the given board.
+    VirtualConnections(const AbstractBoard& board, const Player& player);
+
+    //Returns true if the player can connect its edges whatever the opponent does.
+    bool HasWinningConnection() const;
+    //Returns true if the player can connect its edges by moving first.
+    bool HasWinningThreat() const;
+    //Returns the positions where the opponent has to play to stop the winning threats.
+    //It is empty if there are no threats or if they can't be stopped.
+    std::unordered_set<int> GetMustPlay() const;
+private:
+    struct Connections {
+        std::vector<CellSet> full;
+        std::vector<CellSet> semi;
+    };
+    struct NewConnection {
+        int x;
+        int y;
+        CellSet carrier;
+    };
+
+    void MakePoints(const AbstractBoard& board);
+    void MakeAdjacentConnections();
+    void Search();
+    bool AddFull(int x, int y, const CellSet& carrier);
+    bool AddSemi(int x, int y, const CellSet& carrier);
+    void ApplyAndRule(int x, int z, int y, const CellSet& first, const CellSet& second);
+    void ApplyOrRule(int x, int y, const CellSet& semi);
+    //Returns the edge (1 or 2) of the player touched by the position, or 0.
+    int GetTouchedEdge(int pos) const;
+    //Returns the position of a free point in a set, or an empty set for groups.
+    CellSet GetPointCells(int point) const;
+    long long GetKey(int x, int y) const;
+    const Connections* Find(int x, int y) const;
+
+    const int size_;
+    const Player& player_;
+    //point of every position, -1 for the opponent's stones
+    std::vector<int> point_of_pos_;
+    //position of every free point, -1 for groups and edges
+    std::vector<int> pos_of_point_;
+    int first_edge_;
+    int second_edge_;
+    std::unordered_map<long long, Connections> connections_;
+    //points with a full connection to each point
+    std::vector<std::vector<int>> partners_;
+    std::deque<NewConnection> pending_;
+    //bounds the amount of rule applications so that the search time is predictable
+    int work_left_;
+};
+
+#endif /* defined(__Hex_AI__VirtualConnections__) */
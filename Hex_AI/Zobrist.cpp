@@ -0,0 +1,65 @@
+#include "Zobrist.h"
+
+#include <random>
+#include <vector>
+
+#include "AbstractBoard.h"
+#include "HexConst.h"
+#include "Player.h"
+
+using namespace std;
+
+namespace {
+
+    const uint64_t SEED = 0x9E3779B97F4A7C15ULL;
+
+    //Keys of the stones of the first player followed by the ones of the second player.
+    const vector<uint64_t>& GetKeys() {
+        static const vector<uint64_t> keys = [] {
+            mt19937_64 engine(SEED);
+            vector<uint64_t> keys(2 * HexConst::MAX_POSITIONS);
+            for (uint64_t& it : keys) {
+                it = engine();
+            }
+            return keys;
+        }();
+        return keys;
+    }
+}
+
+uint64_t Zobrist::GetKey(int pos, const Player& player) {
+    return GetKeys()[player.PlaysFirst() ? pos : HexConst::MAX_POSITIONS + pos];
+}
+
+uint64_t Zobrist::GetKey(const AbstractBoard& board) {
+    uint64_t key = 0;
+    int total_pos = board.GetSize() * board.GetSize();
+    for (int pos = 0; pos < total_pos; pos++) {
+        if (board.Belongs(pos, Player::BLUE_PLAYER)) {
+            key ^= GetKey(pos, Player::BLUE_PLAYER);
+        } else if (board.Belongs(pos, Player::RED_PLAYER)) {
+            key ^= GetKey(pos, Player::RED_PLAYER);
+        }
+    }
+    return key;
+}
+
+Zobrist::SymmetricKey Zobrist::GetSymmetricKey(int pos, const Player& player, int board_size) {
+    SymmetricKey key;
+    key.key = GetKey(pos, player);
+    key.rotated = GetKey(board_size * board_size - 1 - pos, player);
+    return key;
+}
+
+Zobrist::SymmetricKey Zobrist::GetSymmetricKey(const AbstractBoard& board) {
+    SymmetricKey key;
+    int total_pos = board.GetSize() * board.GetSize();
+    for (int pos = 0; pos < total_pos; pos++) {
+        if (board.Belongs(pos, Player::BLUE_PLAYER)) {
+            key = key ^ GetSymmetricKey(pos, Player::BLUE_PLAYER, board.GetSize());
+        } else if (board.Belongs(pos, Player::RED_PLAYER)) {
+            key = key ^ GetSymmetricKey(pos, Player::RED_PLAYER, board.GetSize());
+        }
+    }
+    return key;
+}
@@ -0,0 +1,52 @@
+#ifndef __Hex_AI__Zobrist__
+#define __Hex_AI__Zobrist__
+
+#include <cstdint>
+
+class AbstractBoard;
+class Player;
+
+/*
+ * Zobrist hashing of board positions.
+ * Every stone of a player in a position has a random 64 bit key,
+ * and the key of a board is the xor of the keys of its stones, so it can be
+ * updated with one xor when a stone is added or removed.
+ * The keys come from a fixed seed, so they are the same in every run.
+ */
+namespace Zobrist {
+    /*
+     * Keys of a board and of the same board rotated 180 degrees, which is the same
+     * game since every player keeps its edges. The position pos turns into
+     * size * size - 1 - pos. Both keys are updated together with xor.
+     */
+    struct SymmetricKey {
+        uint64_t key = 0;
+        uint64_t rotated = 0;
+
+        SymmetricKey operator^(const SymmetricKey& other) const {
+            SymmetricKey result;
+            result.key = key ^ other.key;
+            result.rotated = rotated ^ other.rotated;
+            return result;
+        }
+        //Returns the same key for both rotations of the board.
+        uint64_t GetCanonical() const {
+            return key < rotated ? key : rotated;
+        }
+        //Returns true if the board is the same after the rotation.
+        bool IsSymmetric() const {
+            return key == rotated;
+        }
+    };
+
+    //Returns the key of a stone of the player in the position.
+    uint64_t GetKey(int pos, const Player& player);
+    //Returns the key of all the stones of the board.
+    uint64_t GetKey(const AbstractBoard& board);
+    //Returns the keys of a stone of the player in the position of a board of the given size.
+    SymmetricKey GetSymmetricKey(int pos, const Player& player, int board_size);
+    //Returns the keys of all the stones of the board.
+    SymmetricKey GetSymmetricKey(const AbstractBoard& board);
+}
+
+#endif /* defined(__Hex_AI__Zobrist__) */
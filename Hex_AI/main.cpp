@@ -6,18 +6,61 @@
  *
  * The user can play against another human or against the computer.
  * The AI runs Monte Carlo simulations to choose its movements.
+ * If the HEX_STATS environment variable has a file name, the stats of
+ * every AI move are appended to it as lines of JSON.
+ * If the HEX_SEARCH environment variable is "tree", the AI searches with a tree
+ * shared by all its threads, see SearchMode.
+ * If the HEX_PROCESSES environment variable has a number of processes, optionally followed
+ * by ":" and the threads of each one, the AI searches with them. See Ai::SetProcesses.
+ * If the HEX_NETWORK environment variable has the file of a network, the AI evaluates
+ * positions with it. See NeuralNetwork.
+ * If the HEX_CACHE environment variable has a file name, the results of the simulations
+ * are kept there for the next runs and shared with other engines, see PersistentCache.
+ * It is also used by the daemon.
+ * If the HEX_CLOCK environment variable has a number of seconds, the AI plays every game
+ * under a clock of that time, see Ai::SetGameClock.
+ * If the HEX_RECORD environment variable has a file name, every game is recorded
+ * in the file with its number added, like "games-1.hexr". See GameRecord.
+ * When built with HEX_TRACING, the HEX_TRACE environment variable names the file
+ * for a Chrome trace of the whole program.
+ *
+ * With "--daemon <socket path> [threads] [record directory]" it runs as an engine for
+ * many games at the same time instead, see EngineDaemon.
+ * With "--analyze <positions file> <results file> [budget ms] [threads]" it analyzes
+ * a file of positions and exits, see BatchAnalyzer.
+ * With "--graph <graph file> [threads]" it loads a weighted graph, in the text or the binary
+ * format of Graph, and prints the weights of its minimum spanning forests and its shortest
+ * paths as a line of JSON, see GraphAlgorithms.
+ * With "--replay <record file>" it plays a recorded game again and compares the moves
+ * and times of the engine with the recorded ones, see GameReplay. A game played with
+ * a network needs the same one in HEX_NETWORK.
  *
  */
 
+#include <algorithm>
 #include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 
+#include "BatchAnalyzer.h"
+#include "EngineDaemon.h"
+#include "GameReplay.h"
+#include "Graph.h"
+#include "GraphAlgorithms.h"
 #include "HexGame.h"
+#include "NeuralBatcher.h"
+#include "PersistentCache.h"
+#include "Trace.h"
 
 using namespace std;
 
+const int DEFAULT_ANALYSIS_MS = 2000;
+
 int GetBoardSize() {
     int size;
     cout << "\nChoose the size of the board (" << HexConst::MIN_BOARD_SIZE << " to "
@@ -95,8 +138,188 @@ bool IsPlayAgain() {
     return play_again;
 }
 
-int main() {
+//Returns the cache named by HEX_CACHE, or null if there is none or it can't be used.
+shared_ptr<PersistentCache> OpenPersistentCache() {
+    const char* path = getenv("HEX_CACHE");
+    if (path == nullptr || *path == '\0') {
+        return nullptr;
+    }
+    try {
+        return make_shared<PersistentCache>(path);
+    } catch (const exception& e) {
+        cerr << e.what() << ", playing without it" << endl;
+        return nullptr;
+    }
+}
+
+int RunDaemon(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Use: " << argv[0] << " --daemon <socket path> [threads] [record directory]" << endl;
+        return 1;
+    }
+    int threads = argc > 3 ? atoi(argv[3]) : Ai::MAX_THREADS;
+    if (threads <= 0) threads = Ai::MAX_THREADS;
+    try {
+        EngineDaemon daemon(argv[2], threads, argc > 4 ? argv[4] : "");
+        daemon.SetPersistentCache(OpenPersistentCache());
+        daemon.Run();
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int RunAnalysis(int argc, char* argv[]) {
+    if (argc < 4) {
+        cerr << "Use: " << argv[0] << " --analyze <positions file> <results file> [budget ms] [threads]"
+                << endl;
+        return 1;
+    }
+    int budget_ms = argc > 4 ? atoi(argv[4]) : DEFAULT_ANALYSIS_MS;
+    if (budget_ms <= 0) budget_ms = DEFAULT_ANALYSIS_MS;
+    int threads = argc > 5 ? atoi(argv[5]) : Ai::MAX_THREADS;
+    if (threads <= 0) threads = Ai::MAX_THREADS;
+    ifstream in(argv[2]);
+    if (!in) {
+        cerr << "Can't read " << argv[2] << endl;
+        return 1;
+    }
+    ofstream out(argv[3]);
+    if (!out) {
+        cerr << "Can't write " << argv[3] << endl;
+        return 1;
+    }
+    BatchAnalyzer analyzer(in, out, threads, budget_ms);
+    int errors = analyzer.Run();
+    if (errors > 0) {
+        cerr << errors << " positions couldn't be analyzed" << endl;
+    }
+    return 0;
+}
+
+//Reads the graph in binary if it starts like the files of Graph::WriteBinary.
+Graph<double, SparseStorage> ReadGraph(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        throw runtime_error("can't read " + path);
+    }
+    char magic[4] = { 0 };
+    in.read(magic, sizeof(magic));
+    if (in.gcount() == sizeof(magic) && memcmp(magic, "HEXG", sizeof(magic)) == 0) {
+        return Graph<double, SparseStorage>::ReadBinary(path);
+    }
+    in.clear();
+    in.seekg(0);
+    return Graph<double, SparseStorage>(in);
+}
+
+int RunGraph(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Use: " << argv[0] << " --graph <graph file> [threads]" << endl;
+        return 1;
+    }
+    int threads = argc > 3 ? atoi(argv[3]) : Ai::MAX_THREADS;
+    if (threads <= 0) threads = Ai::MAX_THREADS;
+    try {
+        Graph<double, SparseStorage> graph = ReadGraph(argv[2]);
+        ThreadPool pool(threads);
+        vector<vector<double>> distances = GraphAlgorithms::GetAllDistances(graph, pool);
+        //pairs of different vertices with a path between them
+        long long paths = 0;
+        double total_distance = 0;
+        for (int x = 0; x < graph.GetSize(); x++) {
+            for (int y = 0; y < graph.GetSize(); y++) {
+                if (x == y || distances[x][y] == GraphAlgorithms::Unreachable<double>()) continue;
+                paths++;
+                total_distance += distances[x][y];
+            }
+        }
+        cout << "{\"vertices\":" << graph.GetSize()
+                << ",\"edges\":" << graph.CountEdges()
+                << ",\"prim\":" << GraphAlgorithms::GetTotalValue(GraphAlgorithms::GetPrimTree(graph))
+                << ",\"kruskal\":" << GraphAlgorithms::GetTotalValue(GraphAlgorithms::GetKruskalTree(graph))
+                << ",\"paths\":" << paths
+                << ",\"mean_distance\":" << (paths > 0 ? total_distance / paths : 0)
+                << "}" << endl;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int RunReplay(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Use: " << argv[0] << " --replay <record file>" << endl;
+        return 1;
+    }
+    try {
+        GameRecord record = GameRecord::Read(argv[2]);
+        shared_ptr<NeuralBatcher> network;
+        const char* network_path = getenv("HEX_NETWORK");
+        if (network_path != nullptr && *network_path != '\0') {
+            network = make_shared<NeuralBatcher>(unique_ptr<NeuralNetwork>(new NeuralNetwork(network_path)));
+        }
+        GameReplay replay(record, cout, network);
+        return replay.Run() == 0 ? 0 : 2;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--daemon") {
+        return RunDaemon(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--analyze") {
+        return RunAnalysis(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--graph") {
+        return RunGraph(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--replay") {
+        return RunReplay(argc, argv);
+    }
     cout << "Welcome to the game of Hex!" << endl;
+    ofstream stats;
+    const char* stats_path = getenv("HEX_STATS");
+    if (stats_path != nullptr && *stats_path != '\0') {
+        stats.open(stats_path, ios::app);
+    }
+    const char* search = getenv("HEX_SEARCH");
+    SearchMode search_mode = search != nullptr && string(search) == "tree" ? SearchMode::SHARED_TREE
+            : SearchMode::PRUNING;
+    const char* processes_value = getenv("HEX_PROCESSES");
+    int processes = 1;
+    int threads_per_process = 1;
+    if (processes_value != nullptr) {
+        processes = atoi(processes_value);
+        const char* threads_value = strchr(processes_value, ':');
+        if (threads_value != nullptr) threads_per_process = max(1, atoi(threads_value + 1));
+    }
+    shared_ptr<NeuralBatcher> network;
+    const char* network_path = getenv("HEX_NETWORK");
+    if (network_path != nullptr && *network_path != '\0') {
+        try {
+            network = make_shared<NeuralBatcher>(unique_ptr<NeuralNetwork>(new NeuralNetwork(network_path)));
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+    }
+    shared_ptr<PersistentCache> persistent_cache = OpenPersistentCache();
+    const char* clock_value = getenv("HEX_CLOCK");
+    double clock_seconds = clock_value != nullptr ? atof(clock_value) : 0;
+    const char* record_path = getenv("HEX_RECORD");
+    int games = 0;
+#if HEX_TRACING >= 1
+    const char* trace_path = getenv("HEX_TRACE");
+    if (trace_path != nullptr && *trace_path != '\0') {
+        Trace::Start(trace_path);
+    }
+#endif
 
     do {
         int board_size = GetBoardSize();
@@ -104,9 +327,30 @@ int main() {
         bool computer_first = IsComputerFirst(is_computer);
 
         HexGame hex(board_size, is_computer, computer_first);
+        if (stats.is_open()) {
+            hex.SetStatsSink(&stats);
+        }
+        hex.SetSearchMode(search_mode);
+        if (processes > 1) {
+            hex.SetProcesses(processes, threads_per_process);
+        }
+        hex.SetNetwork(network);
+        if (persistent_cache) {
+            hex.SetPersistentCache(persistent_cache);
+        }
+        if (clock_seconds > 0) {
+            hex.SetGameClock(clock_seconds);
+        }
+        games++;
+        if (record_path != nullptr && *record_path != '\0') {
+            hex.SetRecordPath(string(record_path) + "-" + to_string(games) + ".hexr");
+        }
         hex.RunGame();
     } while (IsPlayAgain());
 
+#if HEX_TRACING >= 1
+    Trace::Stop();
+#endif
     return 0;
 }
 